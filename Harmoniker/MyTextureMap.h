@@ -17,6 +17,8 @@
     IBOutlet NSTextField *tfNumBands;
     IBOutlet NSTextField *tfNumSamples;
     IBOutlet NSTableView *shTable;
+    IBOutlet NSProgressIndicator *progressIndicator;
+    NSTimer              *jobTimer;
     CGImageRef           imgIrradiance;
 }
 
@@ -29,5 +31,6 @@
 - (IBAction)validateNumBands:(id)sender;
 - (IBAction)validateNumSamples:(id)sender;
 - (IBAction)saveIrradiance:(id)sender;
+- (void)pollHarmonics:(NSTimer*)timer;
 
 @end
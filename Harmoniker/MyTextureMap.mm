@@ -8,7 +8,12 @@
 
 #import "MyTextureMap.h"
 #include "math/SphericalHarmonics.h"
+#include "math/SHJobQueue.h"
 #include "gfx/Color.h"
+#include "gfx/ColorConversion.h"
+#include "gfx/IrradianceRenderer.h"
+#include <algorithm>
+#include <vector>
 
 
 @implementation MyTextureMap
@@ -28,8 +33,18 @@ namespace {
     size_t g_backStride = 4;
     const UInt8* g_frontBytes = NULL;
     const UInt8* g_backBytes = NULL;
+    std::vector<float> g_frontLinear;   ///< front image in linear RGB, converted once
+    std::vector<float> g_backLinear;    ///< back image in linear RGB, converted once
     unsigned char* g_imgBuffer = NULL;
     
+    std::shared_ptr<vd::math::SHJob> g_job;    ///< projection in flight, if any
+    
+    /// Background projections; the images stay readable while a job runs
+    vd::math::SHJobQueue& GetJobQueue() {
+        static vd::math::SHJobQueue queue(1);
+        return queue;
+    }
+    
     const int IRRADIANCE_W = 32;
     const int IRRADIANCE_H = 32;
     const int IRRADIANCE_BANDS = 3;     ///< R,G,B
@@ -40,8 +55,8 @@ namespace {
      *  and back hemispheres of a light probe.
      *  @param theta: the inclination (0-π)
      *  @param phi: the azimuth (0-2π)
-     *  @return normalized RGB value at the given spherical coordinate
-     *  TODO: HDR image support and linear RGB (now it's sRGB)
+     *  @return normalized linear RGB value at the given spherical coordinate
+     *  TODO: HDR image support
      */
     vd::math::Vector3 polarSampler(double theta, double phi) {
         // spherical to UV
@@ -53,18 +68,15 @@ namespace {
             // UV to pixel coordinates
             int y = (int)vd::math::Min(g_frontHeight-1, floorf(g_frontHeight*v));
             int x = (int)vd::math::Min(g_frontWidth-1, floorf(g_frontWidth*u));
-            int i = (int)(g_frontStride*(g_frontWidth*y + x));
-            
-            vd::gfx::Color c(g_frontBytes[i], g_frontBytes[i+1], g_frontBytes[i+2]);
-            return c.ChangeColorSpace(vd::gfx::Color::COLORSPACE_RGB).ToVector3();
+            const float* c = &g_frontLinear[3*(g_frontWidth*y + x)];
+            return vd::math::Vector3(c[0], c[1], c[2]);
         } else { // back
             // UV to pixel coordinates
             u = u - 1.f;
             int y = (int)vd::math::Min(g_backHeight-1, floorf(g_backHeight*v));
             int x = (int)vd::math::Min(g_backWidth-1, floorf(g_backWidth*u));
-            int i = (int)(g_backStride*(g_backWidth*y + x));
-            vd::gfx::Color c(g_frontBytes[i], g_frontBytes[i+1], g_frontBytes[i+2]);
-            return c.ChangeColorSpace(vd::gfx::Color::COLORSPACE_RGB).ToVector3();
+            const float* c = &g_backLinear[3*(g_backWidth*y + x)];
+            return vd::math::Vector3(c[0], c[1], c[2]);
         }
     } // polarSampler
     
@@ -84,49 +96,24 @@ namespace {
     }
     
     /** 
-     * @brief Creates a map of sphere coordinates on 2D
-     * Y axis is defined with respect to the center of the image, being 1 at the center, 0 at radius = 0.7, and -1 if radius >= 1.
-     * TODO: convert linear color to sRGB
+     * @brief Creates a map of sphere coordinates on 2D, for debugging
+     * Uses the sphere layout of IrradianceRenderer, with the normals as colors.
      */
-    void initSphereMap(unsigned char* buffer, int width, int height, int bytesPerPixel, vd::math::SphericalHarmonics* sh = NULL) {
-        float hInv = 1.0f/(float)height;
-        float wInv = 1.0f/(float)width;
+    void initSphereMap(unsigned char* buffer, int width, int height, int bytesPerPixel) {
+        float x[vd::gfx::IrradianceRenderer::PIXELS_PER_CHUNK];
+        float y[vd::gfx::IrradianceRenderer::PIXELS_PER_CHUNK];
+        float z[vd::gfx::IrradianceRenderer::PIXELS_PER_CHUNK];
         for (int j = 0; j<height; ++j) {
-            const float v = 2.f * (j+0.5f) * hInv - 1.f;
-            for (int i = 0; i<width; ++i) {
-                const float u = 2.f * (i+0.5f) * wInv - 1.f;
-                float x = u;
-                float z = v;
-                float radius = sqrtf(x * x + z * z);
-                float y = 1.0f - 2.f * radius;
-                if (y < -1.f) y = -1.f;
-                // normalize x, z (no div by zero, since never in the center for even sizes)
-                float rInv = 1.0f/radius;
-                radius = sqrtf(1.0f-y*y);
-                x = radius * x * rInv;
-                z = radius * z * rInv;
-                
-                if ( sh!= NULL ) {
-                    // get irradiance for given direction
-                    vd::math::Vector3 n(x,z,y);
-                    vd::math::Vector3 irradiance = sh->GetIrradianceApproximation(n);
-                    vd::math::Vector4 c(1);
-                    c(0) = vd::math::Clamp(irradiance.GetX() * vd::math::PI_INV, 0.f, 1.f);
-                    c(1) = vd::math::Clamp(irradiance.GetY() * vd::math::PI_INV, 0.f, 1.f);
-                    c(2) = vd::math::Clamp(irradiance.GetZ() * vd::math::PI_INV, 0.f, 1.f);
-                    c = vd::gfx::Color(vd::gfx::Color::COLORSPACE_RGB, c).ChangeColorSpace(vd::gfx::Color::COLORSPACE_SRGB).ToVector4();
-                    x = 255.f * c.GetX();
-                    y = 255.f * c.GetY();
-                    z = 255.f * c.GetZ();
-                } else {
-                    // for debugging
-                    x = 127.5f * x + 127.5f;
-                    y = 127.5f * y + 127.5f;
-                    z = 127.5f * z + 127.5f;
+            for (int begin = 0; begin<width; begin += vd::gfx::IrradianceRenderer::PIXELS_PER_CHUNK) {
+                const int count = std::min(vd::gfx::IrradianceRenderer::PIXELS_PER_CHUNK, width - begin);
+                vd::gfx::IrradianceRenderer::ComputeDirections(vd::gfx::IrradianceRenderer::LAYOUT_SPHERE, width, height, j, begin, count, x, y, z);
+                for (int k = 0; k<count; ++k) {
+                    unsigned char* p = buffer + bytesPerPixel * (width * j + begin + k);
+                    // the colors of the original map: red = -z, green = y, blue = -x
+                    p[0] = (unsigned char)(-127.5f * z[k] + 127.5f);
+                    p[1] = (unsigned char)(127.5f * y[k] + 127.5f);
+                    p[2] = (unsigned char)(-127.5f * x[k] + 127.5f);
                 }
-                buffer[i*bytesPerPixel+bytesPerPixel*width*j] = (unsigned char)x;
-                buffer[i*bytesPerPixel+bytesPerPixel*width*j+1] = (unsigned char)y;
-                buffer[i*bytesPerPixel+bytesPerPixel*width*j+2] = (unsigned char)z;
             }
         }
     }
@@ -204,7 +191,6 @@ namespace {
     return YES;
 }
 
-// TODO: add a progress bar...
 -(IBAction)computeHarmonics:(id)sender {
     CGImageRef imageFront = [[imageViewFront image] CGImageForProposedRect: NULL context:nil hints:nil];
     CGImageRef imageBack = [[imageViewBack image] CGImageForProposedRect: NULL context:nil hints:nil];
@@ -213,6 +199,13 @@ namespace {
         return;
     }
     
+    // polarSampler reads the images below, so stop the previous projection first
+    if (g_job) {
+        g_job->Cancel();
+        g_job->Wait();
+        g_job.reset();
+    }
+    
     g_frontWidth = CGImageGetWidth(imageFront);
     g_frontHeight = CGImageGetHeight(imageFront);
     g_backWidth = CGImageGetWidth(imageBack);
@@ -249,6 +242,12 @@ namespace {
     g_frontBytes = CFDataGetBytePtr(dataFront);
     g_backBytes = CFDataGetBytePtr(dataBack);
     
+    // convert to linear RGB once, instead of once per sample
+    g_frontLinear.resize(g_frontWidth * g_frontHeight * 3);
+    g_backLinear.resize(g_backWidth * g_backHeight * 3);
+    vd::gfx::SRGB8ToLinear(g_frontBytes, (int)g_frontStride, g_frontWidth * g_frontHeight, &g_frontLinear[0]);
+    vd::gfx::SRGB8ToLinear(g_backBytes, (int)g_backStride, g_backWidth * g_backHeight, &g_backLinear[0]);
+    
 #if false
     for (int y=0; y<g_frontHeight;y++) {
         for (int x=0; x<g_frontWidth;++x) {
@@ -265,10 +264,36 @@ namespace {
     int numBands = [tfNumBands intValue];
     int numSamplesSqr = (int)sqrtf([tfNumSamples intValue]);
     
-    // generate samples
-    vd::math::SphericalHarmonics* sh = new vd::math::SphericalHarmonics(numBands, numSamplesSqr);
-    // compute spherical harmonics
-    sh->ProjectPolarFn(&polarSampler);
+    // generate samples and compute spherical harmonics in the background
+    // (jittered stratification, as the old (bands, sqrt samples) constructor)
+    g_job = GetJobQueue().SubmitPolarFn(vd::math::SHJobDesc(numBands, vd::math::SAMPLE_GENERATOR_JITTERED, numSamplesSqr*numSamplesSqr), &polarSampler);
+    [progressIndicator setDoubleValue:0.0];
+    [jobTimer invalidate];
+    jobTimer = [NSTimer scheduledTimerWithTimeInterval:0.05 target:self selector:@selector(pollHarmonics:) userInfo:nil repeats:YES];
+    
+#endif
+
+    g_frontBytes = NULL;
+    g_backBytes = NULL;
+}
+
+/// Shows the progress of the projection and the irradiance when it is done
+-(void)pollHarmonics:(NSTimer*)timer {
+    if (!g_job) {
+        return;
+    }
+    [progressIndicator setDoubleValue:100.0 * g_job->GetProgress()];
+    if (!g_job->IsFinished()) {
+        return;
+    }
+    [jobTimer invalidate];
+    jobTimer = nil;
+    std::shared_ptr<vd::math::SphericalHarmonics> sh = g_job->GetResult();
+    g_job.reset();
+    if (!sh) {
+        NSLog(@"No coefficients: the projection was cancelled or failed");
+        return;
+    }
     
     //[shTable insertValue:[NSString stringWithFormat:@"test"] inPropertyWithKey:@"Index"];
     
@@ -285,13 +310,9 @@ namespace {
     [colorWell setColor:[NSColor colorWithSRGBRed:r green:g blue:b alpha:1.0f]];
     
     // update sphere map
-    initSphereMap(g_imgBuffer, IRRADIANCE_W, IRRADIANCE_H, IRRADIANCE_BANDS, sh);
+    vd::gfx::IrradianceRenderer renderer(*sh);
+    renderer.RenderSRGB8(vd::gfx::IrradianceRenderer::LAYOUT_SPHERE, IRRADIANCE_W, IRRADIANCE_H, g_imgBuffer, IRRADIANCE_BANDS);
     [self updateImgIrradiance];
-
-#endif
-
-    g_frontBytes = NULL;
-    g_backBytes = NULL;
 }
 
 -(IBAction)validateNumBands:(id)sender{
@@ -322,6 +343,12 @@ namespace {
 }
 
 - (void)dealloc {
+    [jobTimer invalidate];
+    if (g_job) {
+        g_job->Cancel();
+        g_job->Wait();
+        g_job.reset();
+    }
     free(g_imgBuffer);
     g_imgBuffer = NULL;
     [super dealloc];
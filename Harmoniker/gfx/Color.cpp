@@ -7,6 +7,7 @@
 //
 
 #include "Color.h"
+#include "gfx/ColorConversion.h"
 
 GFX_NS_BEGIN
 
@@ -25,9 +26,10 @@ Color Color::ChangeColorSpace(const vd::gfx::Color::ColorSpace cs)
     if (cs == m_cs) return c;
     
     if (m_cs == COLORSPACE_SRGB) { // first convert to linear RGB
-        // SRGB -> RGB
+        // SRGB -> RGB (fast approximation in [0,1], exact curve out of range)
         for (int i=0; i<3; ++i) {
-            if ( m_v(i) > 0.04045 ) c.m_v(i) =(float)pow((m_v(i)+0.055)/1.055, SRGB_GAMMA);
+            if ( m_v(i) >= 0.f && m_v(i) <= 1.f ) c.m_v(i) = SRGBToLinear(m_v(i));
+            else if ( m_v(i) > 0.04045 ) c.m_v(i) =(float)pow((m_v(i)+0.055)/1.055, SRGB_GAMMA);
             else c.m_v(i) = (m_v(i) / 12.92f);
         }
     }
@@ -35,9 +37,11 @@ Color Color::ChangeColorSpace(const vd::gfx::Color::ColorSpace cs)
     // RGB to other spaces
     switch (cs) {
         case COLORSPACE_SRGB:
-            // RGB -> SRGB
+            // RGB -> SRGB (fast approximation in [0,1], exact curve out of range)
             for (int i=0; i<3; ++i) {
-                if ( c.m_v(i) > 0.00304f )
+                if ( c.m_v(i) >= 0.f && c.m_v(i) <= 1.f )
+                    c.m_v(i) = LinearToSRGB(c.m_v(i));
+                else if ( c.m_v(i) > 0.0031308f )
                     c.m_v(i) = (float)(1.055 * pow(c.m_v(i),(1.0/SRGB_GAMMA)) - 0.055);
                 else
                     c.m_v(i) = (float)(12.92 * c.m_v(i));
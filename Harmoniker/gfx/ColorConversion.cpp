@@ -0,0 +1,130 @@
+//
+//  ColorConversion.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <math.h>
+#include "gfx/ColorConversion.h"
+#include "math/SimdFloat.h"
+
+GFX_NS_BEGIN
+
+using math::SimdFloat;
+
+namespace {
+    
+    /**
+     * Table built on first use (thread-safe static initialization).
+     * Same thresholds as the exact curves of the sRGB standard.
+     */
+    struct SRGB8Table {
+        float values[256];
+        SRGB8Table() {
+            for (int i=0; i<256; ++i) {
+                const double c = i / 255.0;
+                values[i] = (float)(c > 0.04045 ? pow((c + 0.055) / 1.055, 2.4) : c / 12.92);
+            }
+        }
+    };
+    
+    /**
+     * Rational minimax-like fits, evaluated in Horner form:
+     *  encode: p(t)/q(t) with t = sqrt(x), for x in (0.0031308, 1]
+     *  decode: p(s)/q(s), for s in (0.04045, 1]
+     * Below the thresholds both curves are linear.
+     */
+    const float ENCODE_P0 = -0.048679006f, ENCODE_P1 = 1.1984437f, ENCODE_P2 = 16.829974f, ENCODE_P3 = 16.065857f;
+    const float ENCODE_Q1 = 13.727319f, ENCODE_Q2 = 18.554548f, ENCODE_Q3 = 0.76379931f;
+    const float DECODE_P0 = 0.00085864965f, DECODE_P1 = 0.036198369f, DECODE_P2 = 0.52918279f, DECODE_P3 = 1.4458550f;
+    const float DECODE_Q1 = 1.2150485f, DECODE_Q2 = -0.24909112f, DECODE_Q3 = 0.046144136f;
+    
+    /// Same code for float and SimdFloat
+    template <typename T>
+    inline T encode(const T& value) {
+        const T x = T::Min(T::Max(value, T(0.0)), T(1.0));
+        const T t = T::Sqrt(x);
+        const T p = ((T(ENCODE_P3) * t + T(ENCODE_P2)) * t + T(ENCODE_P1)) * t + T(ENCODE_P0);
+        const T q = ((T(ENCODE_Q3) * t + T(ENCODE_Q2)) * t + T(ENCODE_Q1)) * t + T(1.0);
+        return T::SelectGreater(x, T(0.0031308), p / q, T(12.92) * x);
+    }
+    template <typename T>
+    inline T decode(const T& value) {
+        const T s = T::Min(T::Max(value, T(0.0)), T(1.0));
+        const T p = ((T(DECODE_P3) * s + T(DECODE_P2)) * s + T(DECODE_P1)) * s + T(DECODE_P0);
+        const T q = ((T(DECODE_Q3) * s + T(DECODE_Q2)) * s + T(DECODE_Q1)) * s + T(1.0);
+        return T::SelectGreater(s, T(0.04045), p / q, s * T(1.0/12.92));
+    }
+    
+    /// Scalar type with the interface of SimdFloat, for the tails and single values
+    struct Scalar {
+        float v;
+        Scalar(double value) : v((float)value) {}
+        inline Scalar operator+(const Scalar& rhs) const { return Scalar(v + rhs.v); }
+        inline Scalar operator*(const Scalar& rhs) const { return Scalar(v * rhs.v); }
+        inline Scalar operator/(const Scalar& rhs) const { return Scalar(v / rhs.v); }
+        static inline Scalar Sqrt(const Scalar& a) { return Scalar(sqrtf(a.v)); }
+        static inline Scalar Min(const Scalar& a, const Scalar& b) { return Scalar(a.v < b.v ? a.v : b.v); }
+        static inline Scalar Max(const Scalar& a, const Scalar& b) { return Scalar(a.v > b.v ? a.v : b.v); }
+        static inline Scalar SelectGreater(const Scalar& a, const Scalar& b, const Scalar& t, const Scalar& f) {
+            return a.v > b.v ? t : f;
+        }
+    };
+    
+} // anonymous namespace
+
+const float* GetSRGB8ToLinearTable()
+{
+    static const SRGB8Table table;
+    return table.values;
+}
+
+float SRGBToLinear(float value)
+{
+    return decode(Scalar(value)).v;
+}
+
+float LinearToSRGB(float value)
+{
+    return encode(Scalar(value)).v;
+}
+
+void SRGB8ToLinear(const unsigned char* src, int srcChannels, size_t numPixels, float* dstRGB)
+{
+    const float* table = GetSRGB8ToLinearTable();
+    for (size_t i=0; i<numPixels; ++i) {
+        const unsigned char* p = src + i * srcChannels;
+        dstRGB[i*3] = table[p[0]];
+        dstRGB[i*3+1] = table[p[1]];
+        dstRGB[i*3+2] = table[p[2]];
+    }
+}
+
+void LinearToSRGB(const float* src, float* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + SimdFloat::WIDTH <= count; i += SimdFloat::WIDTH) {
+        encode(SimdFloat::Load(src + i)).Store(dst + i);
+    }
+    for (; i < count; ++i) {
+        dst[i] = LinearToSRGB(src[i]);
+    }
+}
+
+void LinearToSRGB8(const float* src, unsigned char* dst, size_t count)
+{
+    float srgb[SimdFloat::WIDTH];
+    size_t i = 0;
+    for (; i + SimdFloat::WIDTH <= count; i += SimdFloat::WIDTH) {
+        (encode(SimdFloat::Load(src + i)) * SimdFloat(255.0) + SimdFloat(0.5)).Store(srgb);
+        for (int k=0; k<SimdFloat::WIDTH; ++k) {
+            dst[i+k] = (unsigned char)srgb[k];
+        }
+    }
+    for (; i < count; ++i) {
+        dst[i] = (unsigned char)(LinearToSRGB(src[i]) * 255.f + 0.5f);
+    }
+}
+
+GFX_NS_END
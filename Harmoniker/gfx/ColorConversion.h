@@ -0,0 +1,55 @@
+//
+//  ColorConversion.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef GFX_COLOR_CONVERSION_H_
+#define GFX_COLOR_CONVERSION_H_
+
+#include <stddef.h>
+#include "gfx/gfx_def.h"
+
+GFX_NS_BEGIN
+
+/**
+ * @name sRGB <-> linear RGB conversions
+ * 8-bit sRGB values are decoded exactly through a 256-entry table.
+ * Float values use rational approximations of the sRGB curves, valid in [0,1]
+ * (inputs are clamped to that range):
+ *  - LinearToSRGB: max abs error 5.3e-6 against 1.055 x^(1/2.4) - 0.055
+ *  - SRGBToLinear: max abs error 3.6e-6 against ((x + 0.055) / 1.055)^2.4
+ * Both are far below half an 8-bit step (1/510), so 8-bit round trips are exact.
+ */
+//@{
+
+/// Table of the 256 8-bit sRGB values in linear RGB
+const float* GetSRGB8ToLinearTable();
+
+/// 8-bit sRGB value to linear RGB (exact)
+inline float SRGB8ToLinear(unsigned char value) {
+    return GetSRGB8ToLinearTable()[value];
+}
+
+/// sRGB to linear RGB, one value in [0,1]
+float SRGBToLinear(float value);
+/// linear RGB to sRGB, one value in [0,1]
+float LinearToSRGB(float value);
+
+/**
+ * Converts 8-bit sRGB pixels to linear RGB floats
+ * @param srcChannels bytes per source pixel (3 for RGB, 4 for RGBA); alpha is dropped
+ * @param dstRGB numPixels * 3 floats
+ */
+void SRGB8ToLinear(const unsigned char* src, int srcChannels, size_t numPixels, float* dstRGB);
+/// Converts count linear values to sRGB, several at a time with SIMD
+void LinearToSRGB(const float* src, float* dst, size_t count);
+/// Converts count linear values to rounded 8-bit sRGB, several at a time with SIMD
+void LinearToSRGB8(const float* src, unsigned char* dst, size_t count);
+
+//@}
+
+GFX_NS_END
+
+#endif // GFX_COLOR_CONVERSION_H_
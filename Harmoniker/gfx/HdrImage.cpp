@@ -0,0 +1,302 @@
+//
+//  HdrImage.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Ref. "Real Pixels", Greg Ward, Graphics Gems II
+//
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "gfx/HdrImage.h"
+#include "math/Parallel.h"
+
+GFX_NS_BEGIN
+
+namespace {
+    
+    /// Whether the pixels of an image of that size can be allocated (@see HdrImage::MAX_PIXELS)
+    inline bool isSupportedSize(int width, int height) {
+        return width <= HdrImage::MAX_DIMENSION && height <= HdrImage::MAX_DIMENSION
+            && (int64_t)width * height <= HdrImage::MAX_PIXELS;
+    }
+    
+    /// Reads a line ending in '\n'; false at the end of the data
+    bool readLine(const unsigned char* data, size_t size, size_t& pos, std::string& line) {
+        if (pos >= size) return false;
+        line.clear();
+        while (pos < size && data[pos] != '\n') {
+            line += (char)data[pos++];
+        }
+        ++pos; // skip '\n'
+        return true;
+    }
+    
+    /// Converts a shared-exponent RGBE pixel to linear RGB
+    inline void rgbeToFloat(const unsigned char* rgbe, float* rgb) {
+        if (rgbe[3] == 0) {
+            rgb[0] = rgb[1] = rgb[2] = 0.f;
+        } else {
+            const float f = ldexpf(1.0f, (int)rgbe[3] - (128+8));
+            rgb[0] = rgbe[0] * f;
+            rgb[1] = rgbe[1] * f;
+            rgb[2] = rgbe[2] * f;
+        }
+    }
+    
+    /// True if the scanline at pos starts with the header of a run-length encoded scanline of the given width
+    inline bool isRLEScanline(const unsigned char* data, size_t size, size_t pos, int width) {
+        return width >= 8 && width < 0x8000 && pos + 4 <= size
+            && data[pos] == 2 && data[pos+1] == 2 && (data[pos+2] & 0x80) == 0
+            && ((data[pos+2] << 8) | data[pos+3]) == width;
+    }
+    
+    /**
+     * Skips a run-length encoded scanline without decoding it
+     * @return false if the data is truncated or corrupt
+     */
+    bool skipRLEScanline(const unsigned char* data, size_t size, size_t& pos, int width) {
+        pos += 4;
+        for (int c=0; c<4; ++c) {
+            int x = 0;
+            while (x < width) {
+                if (pos >= size) return false;
+                int count = data[pos++];
+                if (count > 128) {
+                    count -= 128;
+                    pos += 1;
+                } else {
+                    pos += count;
+                }
+                if (count == 0 || x + count > width) return false;
+                x += count;
+            }
+        }
+        return pos <= size;
+    }
+    
+    /// Decodes the 4 run-length encoded channel planes of a scanline into interleaved RGBE
+    void decodeRLEScanline(const unsigned char* data, size_t pos, int width, unsigned char* rgbe) {
+        pos += 4;
+        for (int c=0; c<4; ++c) {
+            int x = 0;
+            while (x < width) {
+                int count = data[pos++];
+                if (count > 128) {
+                    count -= 128;
+                    const unsigned char value = data[pos++];
+                    for (int i=0; i<count; ++i) rgbe[(x++)*4 + c] = value;
+                } else {
+                    for (int i=0; i<count; ++i) rgbe[(x++)*4 + c] = data[pos++];
+                }
+            }
+        }
+    }
+    
+    inline bool isLittleEndianHost() {
+        const unsigned short probe = 1;
+        return *(const unsigned char*)&probe == 1;
+    }
+    
+} // anonymous namespace
+
+HdrImage::HdrImage()
+: m_width(0)
+, m_height(0)
+{
+}
+
+bool HdrImage::fail(const char* message)
+{
+    m_error = message;
+    m_pixels.clear();
+    m_width = m_height = 0;
+    return false;
+}
+
+void HdrImage::resize(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_pixels.assign((size_t)width * height * 3, 0.f);
+}
+
+bool HdrImage::Load(const char* path, int numThreads)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return fail("Can't open file");
+    }
+    std::vector<unsigned char> data;
+    unsigned char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    if (data.size() >= 2 && data[0] == '#' && data[1] == '?') {
+        return DecodeRadianceHDR(&data[0], data.size(), numThreads);
+    }
+    if (data.size() >= 2 && data[0] == 'P' && (data[1] == 'F' || data[1] == 'f')) {
+        return DecodePFM(&data[0], data.size(), numThreads);
+    }
+    return fail("Unknown image format");
+}
+
+/**
+ * A first pass finds where every scanline starts, skipping the run-length
+ * encoded data without expanding it, and then the scanlines are decoded in
+ * parallel. Old-style RLE files can't be split that way, so from the first
+ * scanline that is not in the new format on, they are decoded serially.
+ */
+bool HdrImage::DecodeRadianceHDR(const unsigned char* data, size_t size, int numThreads)
+{
+    size_t pos = 0;
+    std::string line;
+    if (!readLine(data, size, pos, line) || line.compare(0, 2, "#?") != 0) {
+        return fail("Not a Radiance HDR image");
+    }
+    // header, until an empty line
+    while (readLine(data, size, pos, line) && !line.empty()) {
+        if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+            return fail("Unsupported Radiance HDR pixel format");
+        }
+    }
+    // resolution
+    char yAxis[3], xAxis[3];
+    int width = 0, height = 0;
+    if (!readLine(data, size, pos, line)
+        || sscanf(line.c_str(), "%2s %d %2s %d", yAxis, &height, xAxis, &width) != 4
+        || yAxis[1] != 'Y' || strcmp(xAxis, "+X") != 0 || width <= 0 || height <= 0) {
+        return fail("Unsupported Radiance HDR resolution string");
+    }
+    if (!isSupportedSize(width, height)) {
+        return fail("Radiance HDR image too large");
+    }
+    const bool bottomUp = yAxis[0] == '+';
+    resize(width, height);
+    
+    // find the start of every scanline
+    std::vector<size_t> offsets;
+    offsets.reserve(height);
+    while ((int)offsets.size() < height && isRLEScanline(data, size, pos, width)) {
+        offsets.push_back(pos);
+        if (!skipRLEScanline(data, size, pos, width)) {
+            return fail("Truncated Radiance HDR image");
+        }
+    }
+    const int numRLE = (int)offsets.size();
+    math::ParallelFor((numRLE + 15) / 16, numThreads, [&](int task) {
+        std::vector<unsigned char> rgbe((size_t)width * 4);
+        const int end = (task + 1) * 16 < numRLE ? (task + 1) * 16 : numRLE;
+        for (int y = task * 16; y < end; ++y) {
+            decodeRLEScanline(data, offsets[y], width, &rgbe[0]);
+            float* row = &m_pixels[(size_t)(bottomUp ? height - 1 - y : y) * width * 3];
+            for (int x=0; x<width; ++x) {
+                rgbeToFloat(&rgbe[x*4], row + x*3);
+            }
+        }
+    });
+    
+    // flat or old-style RLE pixels for the remaining scanlines
+    unsigned char prev[4] = { 0, 0, 0, 0 };
+    int shift = 0;
+    for (size_t i = (size_t)numRLE * width; i < (size_t)width * height; ) {
+        if (pos + 4 > size) {
+            return fail("Truncated Radiance HDR image");
+        }
+        const unsigned char* p = data + pos;
+        pos += 4;
+        if (p[0] == 1 && p[1] == 1 && p[2] == 1) {
+            // repeat the previous pixel; consecutive runs are the higher bytes of the count,
+            // and a run can't go past the end of its scanline
+            if (shift >= 24) {
+                return fail("Bad Radiance HDR run length");
+            }
+            size_t count = (size_t)p[3] << shift;
+            shift += 8;
+            if (count > (size_t)width - i % width) {
+                return fail("Bad Radiance HDR run length");
+            }
+            for (; count > 0; --count, ++i) {
+                const size_t y = i / width;
+                const size_t x = i % width;
+                rgbeToFloat(prev, &m_pixels[((bottomUp ? height - 1 - y : y) * width + x) * 3]);
+            }
+        } else {
+            shift = 0;
+            memcpy(prev, p, 4);
+            const size_t y = i / width;
+            const size_t x = i % width;
+            rgbeToFloat(prev, &m_pixels[((bottomUp ? height - 1 - y : y) * width + x) * 3]);
+            ++i;
+        }
+    }
+    m_error.clear();
+    return true;
+}
+
+/**
+ * PFM rows are stored from bottom to top; a negative scale means little-endian.
+ * Rows are converted (byte swapped if needed, and expanded to RGB for
+ * greyscale images) in parallel.
+ */
+bool HdrImage::DecodePFM(const unsigned char* data, size_t size, int numThreads)
+{
+    if (size < 3 || data[0] != 'P' || (data[1] != 'F' && data[1] != 'f')) {
+        return fail("Not a PFM image");
+    }
+    const int channels = data[1] == 'F' ? 3 : 1;
+    // the header is 3 text tokens after the signature, followed by a single whitespace
+    size_t pos = 2;
+    std::string tokens[3];
+    for (int t=0; t<3; ++t) {
+        while (pos < size && isspace(data[pos])) ++pos;
+        while (pos < size && !isspace(data[pos])) tokens[t] += (char)data[pos++];
+    }
+    ++pos;
+    const int width = atoi(tokens[0].c_str());
+    const int height = atoi(tokens[1].c_str());
+    const double scale = atof(tokens[2].c_str());
+    if (width <= 0 || height <= 0 || scale == 0.0) {
+        return fail("Bad PFM header");
+    }
+    if (!isSupportedSize(width, height)) {
+        return fail("PFM image too large");
+    }
+    const size_t rowBytes = (size_t)width * channels * sizeof(float);
+    if (pos > size || size - pos < rowBytes * height) {
+        return fail("Truncated PFM image");
+    }
+    const bool swap = (scale < 0.0) != isLittleEndianHost();
+    resize(width, height);
+    const unsigned char* pixels = data + pos;
+    math::ParallelFor(height, numThreads, [&](int y) {
+        const unsigned char* src = pixels + (size_t)(height - 1 - y) * rowBytes;
+        float* row = &m_pixels[(size_t)y * width * 3];
+        for (int x=0; x<width; ++x) {
+            float value[3] = { 0.f, 0.f, 0.f };
+            for (int c=0; c<channels; ++c) {
+                unsigned char b[4];
+                memcpy(b, src + ((size_t)x * channels + c) * 4, 4);
+                if (swap) {
+                    unsigned char t = b[0]; b[0] = b[3]; b[3] = t;
+                    t = b[1]; b[1] = b[2]; b[2] = t;
+                }
+                memcpy(&value[c], b, 4);
+            }
+            row[x*3] = value[0];
+            row[x*3+1] = value[channels > 1 ? 1 : 0];
+            row[x*3+2] = value[channels > 1 ? 2 : 0];
+        }
+    });
+    m_error.clear();
+    return true;
+}
+
+GFX_NS_END
@@ -0,0 +1,68 @@
+//
+//  HdrImage.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef GFX_HDR_IMAGE_H_
+#define GFX_HDR_IMAGE_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "gfx/gfx_def.h"
+#include "math/RadianceImage.h"
+
+GFX_NS_BEGIN
+
+/**
+ *  High dynamic range image, decoded to linear RGB floats (3 per pixel, rows
+ *  from top to bottom), so it can be handed to the projector with GetView()
+ *  without any per-sample conversion.
+ *  Supported formats, with no external dependencies:
+ *  - Radiance RGBE (.hdr, .pic): flat, RLE and old-style RLE scanlines
+ *  - Portable Float Map (.pfm): color (PF) and greyscale (Pf), either endianness
+ *  Scanlines are decoded in parallel.
+ */
+class HdrImage {
+public:
+    /// Largest width or height accepted
+    static const int MAX_DIMENSION = 1 << 18;
+    /// Largest number of pixels accepted (3 GB of floats), so a bad header can't ask for any size
+    static const int MAX_PIXELS = 1 << 28;
+    
+public:
+    HdrImage();
+    
+    /// Loads a file, choosing the decoder from its signature
+    bool Load(const char* path, int numThreads = 0);
+    /// Decodes a Radiance RGBE image from memory
+    bool DecodeRadianceHDR(const unsigned char* data, size_t size, int numThreads = 0);
+    /// Decodes a Portable Float Map from memory
+    bool DecodePFM(const unsigned char* data, size_t size, int numThreads = 0);
+    
+    // -----------------------------------------------------------
+    // getters
+    // -----------------------------------------------------------
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+    inline const float* GetPixels() const { return m_pixels.empty() ? NULL : &m_pixels[0]; }
+    inline math::RadianceImage GetView() const { return math::RadianceImage(GetPixels(), m_width, m_height, 3); }
+    /// Description of the last error
+    inline const std::string& GetError() const { return m_error; }
+    
+private:
+    bool fail(const char* message);
+    void resize(int width, int height);
+    
+private:
+    std::vector<float>  m_pixels;   ///< linear RGB
+    int                 m_width;    ///< in pixels
+    int                 m_height;   ///< in pixels
+    std::string         m_error;    ///< last error
+}; // HdrImage
+
+GFX_NS_END
+
+#endif // GFX_HDR_IMAGE_H_
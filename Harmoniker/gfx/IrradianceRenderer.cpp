@@ -0,0 +1,166 @@
+//
+//  IrradianceRenderer.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <math.h>
+#include <algorithm>
+#include "gfx/IrradianceRenderer.h"
+#include "gfx/ColorConversion.h"
+#include "math/Parallel.h"
+#include "math/TexelTable.h"
+
+GFX_NS_BEGIN
+
+using math::Vector3;
+
+namespace {
+    const double PI_D = 3.14159265358979323846;
+    
+    /// Rows rendered by a single task
+    const int ROWS_PER_TASK = 4;
+    
+    const math::TexelTable::Mapping CUBE_FACES[6] = {
+        math::TexelTable::MAPPING_CUBE_POSITIVE_X,
+        math::TexelTable::MAPPING_CUBE_NEGATIVE_X,
+        math::TexelTable::MAPPING_CUBE_POSITIVE_Y,
+        math::TexelTable::MAPPING_CUBE_NEGATIVE_Y,
+        math::TexelTable::MAPPING_CUBE_POSITIVE_Z,
+        math::TexelTable::MAPPING_CUBE_NEGATIVE_Z
+    };
+    
+    /// Calls fn(row, begin, count) for every chunk of every row, in parallel over groups of rows
+    template <typename Fn>
+    void forEachChunk(int width, int height, int numThreads, const Fn& fn) {
+        const int numTasks = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+        math::ParallelFor(numTasks, numThreads, [&](int task) {
+            const int rowEnd = std::min(height, (task + 1) * ROWS_PER_TASK);
+            for (int j = task * ROWS_PER_TASK; j < rowEnd; ++j) {
+                for (int i = 0; i < width; i += IrradianceRenderer::PIXELS_PER_CHUNK) {
+                    fn(j, i, std::min(IrradianceRenderer::PIXELS_PER_CHUNK, width - i));
+                }
+            }
+        });
+    }
+} // anonymous namespace
+
+IrradianceRenderer::IrradianceRenderer(const math::SphericalHarmonics& sh)
+: m_sh(sh)
+, m_scale(math::PI_INV)
+, m_numThreads(0)
+{
+}
+
+bool IrradianceRenderer::IsValidSize(Layout layout, int width, int height)
+{
+    if (width <= 0 || height <= 0) return false;
+    if (layout == LAYOUT_CUBE) return height == 6 * width;
+    return true;
+}
+
+/**
+ * The sphere layout is the preview of the application: the distance r to the
+ * center (in [0,1] at the border of the image) gives y = 1 - 2r, so the border
+ * of the inscribed circle is the horizon and the corners are clamped to -Y.
+ */
+void IrradianceRenderer::ComputeDirections(Layout layout, int width, int height, int row, int begin, int count, float* x, float* y, float* z)
+{
+    switch (layout) {
+        case LAYOUT_SPHERE: {
+            const float v = 2.f * (row + 0.5f) / (float)height - 1.f;
+            for (int k = 0; k < count; ++k) {
+                const float u = 2.f * (begin + k + 0.5f) / (float)width - 1.f;
+                const float radius = sqrtf(u * u + v * v);
+                const float dy = std::max(-1.f, 1.f - 2.f * radius);
+                // radius > 0 unless the center is a pixel center (odd sizes)
+                const float s = radius > 0.f ? sqrtf(1.f - dy * dy) / radius : 0.f;
+                x[k] = -s * v;
+                y[k] = dy;
+                z[k] = -s * u;
+            }
+            break;
+        }
+        case LAYOUT_EQUIRECT: {
+            const double theta = PI_D * (row + 0.5) / height;
+            const float sinTheta = (float)sin(theta);
+            const float cosTheta = (float)cos(theta);
+            for (int k = 0; k < count; ++k) {
+                const double phi = 2.0 * PI_D * (begin + k + 0.5) / width;
+                x[k] = sinTheta * (float)sin(phi);
+                y[k] = cosTheta;
+                z[k] = sinTheta * (float)cos(phi);
+            }
+            break;
+        }
+        case LAYOUT_CUBE: {
+            const int face = row / width;
+            const float v = 2.f * (row - face * width + 0.5f) / (float)width - 1.f;
+            for (int k = 0; k < count; ++k) {
+                const float u = 2.f * (begin + k + 0.5f) / (float)width - 1.f;
+                const Vector3 d = math::TexelTable::GetCubeDirection(CUBE_FACES[face], u, v);
+                x[k] = d.GetX();
+                y[k] = d.GetY();
+                z[k] = d.GetZ();
+            }
+            break;
+        }
+    }
+}
+
+/// Scaled irradiance of count pixels, as packed RGB
+void IrradianceRenderer::renderChunk(Layout layout, int width, int height, int row, int begin, int count, float* rgb) const
+{
+    float x[PIXELS_PER_CHUNK], y[PIXELS_PER_CHUNK], z[PIXELS_PER_CHUNK];
+    float r[PIXELS_PER_CHUNK], g[PIXELS_PER_CHUNK], b[PIXELS_PER_CHUNK];
+    ComputeDirections(layout, width, height, row, begin, count, x, y, z);
+    m_sh.GetIrradianceApproximation(count, x, y, z, r, g, b);
+    for (int k = 0; k < count; ++k) {
+        rgb[3*k] = m_scale * r[k];
+        rgb[3*k+1] = m_scale * g[k];
+        rgb[3*k+2] = m_scale * b[k];
+    }
+}
+
+bool IrradianceRenderer::Render(Layout layout, int width, int height, float* rgb, int pixelStride, size_t rowStride) const
+{
+    if (rgb == NULL || pixelStride < 3 || !IsValidSize(layout, width, height)) return false;
+    if (rowStride == 0) rowStride = (size_t)width * pixelStride;
+    forEachChunk(width, height, m_numThreads, [&](int row, int begin, int count) {
+        float* out = rgb + row * rowStride + (size_t)begin * pixelStride;
+        if (pixelStride == 3) {
+            renderChunk(layout, width, height, row, begin, count, out);
+            return;
+        }
+        float chunk[3 * PIXELS_PER_CHUNK];
+        renderChunk(layout, width, height, row, begin, count, chunk);
+        for (int k = 0; k < count; ++k) {
+            out[k*pixelStride] = chunk[3*k];
+            out[k*pixelStride+1] = chunk[3*k+1];
+            out[k*pixelStride+2] = chunk[3*k+2];
+        }
+    });
+    return true;
+}
+
+bool IrradianceRenderer::RenderSRGB8(Layout layout, int width, int height, unsigned char* pixels, int bytesPerPixel, size_t rowStride) const
+{
+    if (pixels == NULL || bytesPerPixel < 3 || !IsValidSize(layout, width, height)) return false;
+    if (rowStride == 0) rowStride = (size_t)width * bytesPerPixel;
+    forEachChunk(width, height, m_numThreads, [&](int row, int begin, int count) {
+        float chunk[3 * PIXELS_PER_CHUNK];
+        unsigned char srgb[3 * PIXELS_PER_CHUNK];
+        renderChunk(layout, width, height, row, begin, count, chunk);
+        LinearToSRGB8(chunk, srgb, 3 * count);
+        unsigned char* out = pixels + row * rowStride + (size_t)begin * bytesPerPixel;
+        for (int k = 0; k < count; ++k) {
+            out[k*bytesPerPixel] = srgb[3*k];
+            out[k*bytesPerPixel+1] = srgb[3*k+1];
+            out[k*bytesPerPixel+2] = srgb[3*k+2];
+        }
+    });
+    return true;
+}
+
+GFX_NS_END
@@ -0,0 +1,81 @@
+//
+//  IrradianceRenderer.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef GFX_IRRADIANCE_RENDERER_H_
+#define GFX_IRRADIANCE_RENDERER_H_
+
+#include <stddef.h>
+#include "gfx/gfx_def.h"
+#include "math/SphericalHarmonics.h"
+
+GFX_NS_BEGIN
+
+/**
+ *  Renders the irradiance of a SphericalHarmonics object into images.
+ *  The pixels go to buffers owned by the caller, so a renderer can be used
+ *  every frame without allocating. Rows are rendered in parallel.
+ */
+class IrradianceRenderer {
+public:
+    enum Layout {
+        /// preview of a sphere seen from above: +Y at the center, -Y at the border and beyond,
+        /// -Z to the right and -X downwards (X and Y of the irradiance matrices, as the app always showed it)
+        LAYOUT_SPHERE = 0,
+        /// latitude-longitude map, as ProjectEquirect reads it
+        LAYOUT_EQUIRECT,
+        /// the 6 faces of a cube map stacked vertically (+X,-X,+Y,-Y,+Z,-Z), height = 6 * width
+        LAYOUT_CUBE
+    };
+    
+    /// Pixels computed at once by a task, in stack buffers
+    static const int PIXELS_PER_CHUNK = 64;
+    
+public:
+    /// The SH object must outlive the renderer; it renders the irradiance bands of the SH, whatever their number
+    IrradianceRenderer(const math::SphericalHarmonics& sh);
+    
+    // -----------------------------------------------------------
+    // getters & setters
+    // -----------------------------------------------------------
+    inline float GetScale() const { return m_scale; }
+    inline int GetNumThreads() const { return m_numThreads; }
+    /// Factor applied to the irradiance (1/π by default, the radiosity of a white diffuse surface)
+    inline void SetScale(float scale) { m_scale = scale; }
+    /// Number of worker threads (0 = all hardware threads)
+    inline void SetNumThreads(int numThreads) { m_numThreads = numThreads; }
+    
+    /**
+     * Renders linear RGB
+     * @param rgb first pixel of the top row; pixelStride floats per pixel, rowStride floats per row (0 = packed)
+     * @return false if the size is not valid for the layout
+     */
+    bool Render(Layout layout, int width, int height, float* rgb, int pixelStride = 3, size_t rowStride = 0) const;
+    /**
+     * Renders 8-bit sRGB, clamping the scaled irradiance to [0,1]
+     * @param pixels first pixel of the top row; bytesPerPixel bytes per pixel (alpha is not written), rowStride bytes per row (0 = packed)
+     * @return false if the size is not valid for the layout
+     */
+    bool RenderSRGB8(Layout layout, int width, int height, unsigned char* pixels, int bytesPerPixel = 3, size_t rowStride = 0) const;
+    
+    /// Directions of count pixels of a row, starting at column begin (as in Spherical::ToVector3)
+    static void ComputeDirections(Layout layout, int width, int height, int row, int begin, int count, float* x, float* y, float* z);
+    /// Whether an image of that size can be rendered with the given layout
+    static bool IsValidSize(Layout layout, int width, int height);
+    
+private:
+    void renderChunk(Layout layout, int width, int height, int row, int begin, int count, float* rgb) const;
+    
+private:
+    const math::SphericalHarmonics& m_sh;
+    float   m_scale;        ///< factor applied to the irradiance
+    int     m_numThreads;   ///< worker threads (0 = hardware threads)
+    
+}; // IrradianceRenderer
+
+GFX_NS_END
+
+#endif // GFX_IRRADIANCE_RENDERER_H_
@@ -0,0 +1,147 @@
+//
+//  MappedProbe.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gfx/MappedProbe.h"
+
+GFX_NS_BEGIN
+
+namespace {
+    const char MAGIC[4] = { 'V', 'D', 'R', 'P' };
+    
+    inline bool isLittleEndianHost() {
+        const unsigned short probe = 1;
+        return *(const unsigned char*)&probe == 1;
+    }
+}
+
+MappedProbe::MappedProbe()
+: m_pMap(NULL)
+, m_size(0)
+, m_layout(LAYOUT_EQUIRECT)
+{
+}
+
+MappedProbe::~MappedProbe()
+{
+    Close();
+}
+
+bool MappedProbe::fail(const char* message)
+{
+    Close();
+    m_error = message;
+    return false;
+}
+
+bool MappedProbe::Open(const char* path, Access access)
+{
+    Close();
+    if (!isLittleEndianHost()) {
+        return fail("Raw probes can only be mapped on little-endian hosts");
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return fail("Can't open file");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RawProbeHeader)) {
+        close(fd);
+        return fail("Not a raw probe");
+    }
+    m_size = (size_t)st.st_size;
+    void* map = mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (map == MAP_FAILED) {
+        return fail("Can't map file");
+    }
+    m_pMap = map;
+    
+    RawProbeHeader header;
+    memcpy(&header, m_pMap, sizeof(header));
+    if (memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION) {
+        return fail("Not a raw probe");
+    }
+    if (header.width == 0 || header.height == 0
+        || header.width > MAX_DIMENSION || header.height > MAX_DIMENSION
+        || (header.channels != 3 && header.channels != 4)
+        || header.rowStride % 4 != 0 || header.dataOffset % 4 != 0
+        || header.rowStride < header.width * header.channels * sizeof(float)
+        || header.layout > LAYOUT_CUBE
+        || (header.layout == LAYOUT_CUBE && header.height != 6 * header.width)) {
+        return fail("Bad raw probe header");
+    }
+    const uint64_t dataSize = (uint64_t)header.rowStride * (header.height - 1) + header.width * header.channels * sizeof(float);
+    if (header.dataOffset > m_size || (uint64_t)(m_size - header.dataOffset) < dataSize) {
+        return fail("Truncated raw probe");
+    }
+    m_layout = (Layout)header.layout;
+    m_view = math::RadianceImage((const float*)((const char*)m_pMap + header.dataOffset),
+                                 (int)header.width, (int)header.height, (int)header.channels,
+                                 header.rowStride / sizeof(float));
+    Advise(access);
+    m_error.clear();
+    return true;
+}
+
+void MappedProbe::Close()
+{
+    if (m_pMap != NULL) {
+        munmap(m_pMap, m_size);
+        m_pMap = NULL;
+    }
+    m_size = 0;
+    m_view = math::RadianceImage();
+}
+
+void MappedProbe::Advise(Access access)
+{
+    if (m_pMap == NULL) return;
+    if (access == ACCESS_SEQUENTIAL) {
+        madvise(m_pMap, m_size, MADV_SEQUENTIAL);
+        madvise(m_pMap, m_size, MADV_WILLNEED);
+    } else {
+        madvise(m_pMap, m_size, MADV_RANDOM);
+    }
+}
+
+bool MappedProbe::Write(const char* path, const math::RadianceImage& image, Layout layout)
+{
+    if (!isLittleEndianHost() || !image.IsValid()
+        || (uint32_t)image.width > MAX_DIMENSION || (uint32_t)image.height > MAX_DIMENSION) {
+        return false;
+    }
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return false;
+    RawProbeHeader header;
+    memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    header.width = image.width;
+    header.height = image.height;
+    header.channels = 3;
+    header.rowStride = image.width * 3 * sizeof(float);
+    header.dataOffset = sizeof(RawProbeHeader);
+    header.layout = layout;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int y = 0; ok && y < image.height; ++y) {
+        if (image.pixelStride == 3) {
+            ok = fwrite(image.GetRow(y), sizeof(float) * 3, image.width, file) == (size_t)image.width;
+        } else {
+            for (int x = 0; ok && x < image.width; ++x) {
+                ok = fwrite(image.GetPixel(x, y), sizeof(float), 3, file) == 3;
+            }
+        }
+    }
+    return fclose(file) == 0 && ok;
+}
+
+GFX_NS_END
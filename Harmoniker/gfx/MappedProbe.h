@@ -0,0 +1,100 @@
+//
+//  MappedProbe.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef GFX_MAPPED_PROBE_H_
+#define GFX_MAPPED_PROBE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "gfx/gfx_def.h"
+#include "math/RadianceImage.h"
+
+GFX_NS_BEGIN
+
+/**
+ *  Raw float light probe, memory-mapped read-only so the projector reads the
+ *  pages of the file directly: there is no decoding nor copy, and processes
+ *  that map the same probe share it through the OS page cache.
+ *
+ *  File layout: a RawProbeHeader followed, at dataOffset, by height rows of
+ *  width little-endian float pixels with the given number of channels (3 for
+ *  RGB, 4 for RGBA), rowStride bytes apart.
+ */
+class MappedProbe {
+public:
+    static const uint32_t VERSION = 1;
+    /// Largest width or height accepted, so pixel offsets and row sizes can't overflow
+    static const uint32_t MAX_DIMENSION = 1 << 18;
+    
+    enum Layout {
+        LAYOUT_EQUIRECT = 0,    ///< latitude-longitude map
+        LAYOUT_CUBE             ///< 6 square faces stacked vertically: +X, -X, +Y, -Y, +Z, -Z
+    };
+    
+    enum Access {
+        ACCESS_SEQUENTIAL = 0,  ///< whole-image integration: aggressive read-ahead
+        ACCESS_RANDOM           ///< point sampling: no read-ahead
+    };
+    
+    /// Header of the file, all fields little-endian
+    struct RawProbeHeader {
+        char        magic[4];   ///< "VDRP"
+        uint32_t    version;    ///< VERSION
+        uint32_t    width;      ///< in pixels
+        uint32_t    height;     ///< in pixels
+        uint32_t    channels;   ///< floats per pixel, 3 or 4
+        uint32_t    rowStride;  ///< bytes per row, a multiple of 4
+        uint32_t    dataOffset; ///< bytes from the start of the file to the first row, a multiple of 4
+        uint32_t    layout;     ///< @see Layout
+    };
+    
+public:
+    MappedProbe();
+    ~MappedProbe();
+    
+    /// Maps a probe file; false on error (@see GetError)
+    bool Open(const char* path, Access access = ACCESS_SEQUENTIAL);
+    /// Unmaps the file; views obtained before become invalid
+    void Close();
+    /// Changes the read-ahead hint of the mapping
+    void Advise(Access access);
+    
+    /// Writes an image as a raw probe file (RGB, tightly packed rows)
+    static bool Write(const char* path, const math::RadianceImage& image, Layout layout = LAYOUT_EQUIRECT);
+    
+    // -----------------------------------------------------------
+    // getters
+    // -----------------------------------------------------------
+    inline bool IsOpen() const { return m_pMap != NULL; }
+    inline Layout GetLayout() const { return m_layout; }
+    /// The whole image, pointing into the mapped pages
+    inline const math::RadianceImage& GetView() const { return m_view; }
+    /// A face of a LAYOUT_CUBE probe
+    inline math::RadianceImage GetFace(int face) const {
+        return m_view.GetRegion(0, face * m_view.width, m_view.width, m_view.width);
+    }
+    inline const std::string& GetError() const { return m_error; }
+    
+private:
+    bool fail(const char* message);
+    
+    // non-copyable
+    MappedProbe(const MappedProbe&);
+    MappedProbe& operator=(const MappedProbe&);
+    
+private:
+    void*               m_pMap;     ///< mapped file
+    size_t              m_size;     ///< size of the mapping
+    Layout              m_layout;   ///< how the image covers the sphere
+    math::RadianceImage m_view;     ///< pixels, inside the mapping
+    std::string         m_error;    ///< last error
+}; // MappedProbe
+
+GFX_NS_END
+
+#endif // GFX_MAPPED_PROBE_H_
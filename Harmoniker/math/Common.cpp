@@ -42,4 +42,18 @@ double Factorial(int n)
     }
 }
 
+void* AlignedMalloc(size_t size, size_t alignment)
+{
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+void AlignedFree(void* ptr)
+{
+    free(ptr);
+}
+
 MATH_NS_END
@@ -40,12 +40,17 @@ inline float Min(const float a, const float b) {
 inline float Clamp(const float value, const float lowest, const float highest) {
     return (value<lowest)?lowest:(value>highest)?highest:value;
 }
-/// Random number between 0 and 1
+/// Random number in [0,1), with 24 bits of resolution. It uses the global
+/// random() state: use CounterRandom for parallel or reproducible sequences
 inline float Randf() {
-    return (random()%1001) / 1000.0f;
+    return (random() & 0xffffff) * (1.0f / 16777216.0f);
 }
 /// Factorial
 double Factorial(int n);
+/// Allocates memory aligned to the given power of 2 (release with AlignedFree)
+void* AlignedMalloc(size_t size, size_t alignment);
+/// Releases memory allocated with AlignedMalloc
+void AlignedFree(void* ptr);
 
 MATH_NS_END
 
@@ -0,0 +1,76 @@
+//
+//  CounterRandom.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_COUNTER_RANDOM_H_
+#define MATH_COUNTER_RANDOM_H_
+
+#include <stdint.h>
+#include "math/math_def.h"
+
+MATH_NS_BEGIN
+
+/**
+ *  Counter-based random numbers (Philox2x32-10): the numbers of a stream are a
+ *  pure function of (seed, stream, index), so any thread can generate any part
+ *  of any stream without shared state, and the results do not depend on the
+ *  order or the number of threads.
+ *  @see "Parallel Random Numbers: As Easy as 1, 2, 3", Salmon et al.
+ */
+class CounterRandom {
+public:
+    CounterRandom(uint32_t seed, uint32_t stream = 0)
+    : m_seed(seed)
+    , m_stream(stream)
+    , m_counter(0)
+    {}
+    
+    /// Two random 32-bit integers at the given index of the stream
+    inline void Get(uint32_t index, uint32_t* a, uint32_t* b) const {
+        uint32_t c0 = index, c1 = m_stream, key = m_seed;
+        for (int round = 0; round < ROUNDS; ++round) {
+            const uint64_t product = (uint64_t)MULTIPLIER * c0;
+            c0 = (uint32_t)(product >> 32) ^ key ^ c1;
+            c1 = (uint32_t)product;
+            key += KEY_INCREMENT;
+        }
+        *a = c0;
+        *b = c1;
+    }
+    /// Two random numbers in [0,1), with 24 bits each (every float of the form k/2^24)
+    inline void GetFloat2(uint32_t index, float* u, float* v) const {
+        uint32_t a, b;
+        Get(index, &a, &b);
+        *u = ToFloat(a);
+        *v = ToFloat(b);
+    }
+    /// Sequential use: the next number of the stream in [0,1)
+    inline float NextFloat() {
+        uint32_t a, b;
+        Get(m_counter++, &a, &b);
+        return ToFloat(a);
+    }
+    
+    /// Top 24 bits of an integer to [0,1)
+    static inline float ToFloat(uint32_t bits) {
+        return (bits >> 8) * (1.0f / 16777216.0f);
+    }
+    
+private:
+    static const int ROUNDS = 10;
+    static const uint32_t MULTIPLIER = 0xD256D193U;
+    static const uint32_t KEY_INCREMENT = 0x9E3779B9U;
+    
+private:
+    uint32_t    m_seed;     ///< key of the generator
+    uint32_t    m_stream;   ///< independent sequence for the same seed
+    uint32_t    m_counter;  ///< next index of NextFloat
+    
+}; // CounterRandom
+
+MATH_NS_END
+
+#endif // MATH_COUNTER_RANDOM_H_
@@ -0,0 +1,54 @@
+//
+//  Parallel.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "math/Parallel.h"
+
+MATH_NS_BEGIN
+
+int GetHardwareThreads()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? (int)n : 1;
+}
+
+int ResolveNumThreads(int numThreads)
+{
+    return numThreads > 0 ? numThreads : GetHardwareThreads();
+}
+
+void ParallelFor(int numTasks, int numThreads, const std::function<void(int)>& task)
+{
+    if (numTasks <= 0) return;
+    numThreads = ResolveNumThreads(numThreads);
+    if (numThreads > numTasks) numThreads = numTasks;
+    if (numThreads == 1) {
+        for (int i=0; i<numTasks; ++i) {
+            task(i);
+        }
+        return;
+    }
+    std::atomic<int> next(0);
+    std::function<void()> worker = [&]() {
+        for (int i = next++; i < numTasks; i = next++) {
+            task(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads-1);
+    for (int t=1; t<numThreads; ++t) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (size_t t=0; t<threads.size(); ++t) {
+        threads[t].join();
+    }
+}
+
+MATH_NS_END
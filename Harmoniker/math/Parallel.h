@@ -0,0 +1,33 @@
+//
+//  Parallel.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_PARALLEL_H_
+#define MATH_PARALLEL_H_
+
+#include <functional>
+#include "math/math_def.h"
+
+MATH_NS_BEGIN
+
+/// Number of hardware threads available (at least 1)
+int GetHardwareThreads();
+
+/// Resolves a thread count: 0 (or negative) means "all hardware threads"
+int ResolveNumThreads(int numThreads);
+
+/**
+ * Runs task(i) for every i in [0, numTasks) using up to numThreads threads
+ * (the calling thread included). Tasks are handed out dynamically, so the
+ * caller must make every task write to its own output slot; reducing those
+ * slots in task order afterwards gives results that do not depend on the
+ * number of threads.
+ */
+void ParallelFor(int numTasks, int numThreads, const std::function<void(int)>& task);
+
+MATH_NS_END
+
+#endif // MATH_PARALLEL_H_
@@ -0,0 +1,48 @@
+//
+//  RadianceImage.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_RADIANCE_IMAGE_H_
+#define MATH_RADIANCE_IMAGE_H_
+
+#include <stddef.h>
+#include "math/math_def.h"
+
+MATH_NS_BEGIN
+
+/**
+ *  Read-only view of an image of linear RGB radiance stored as floats.
+ *  It does not own the pixels. Pixels are pixelStride floats apart (3 for
+ *  RGB, 4 for RGBA) and rows are rowStride floats apart.
+ */
+struct RadianceImage {
+    const float*    data;           ///< first float of the top row
+    int             width;          ///< in pixels
+    int             height;         ///< in pixels
+    int             pixelStride;    ///< floats per pixel
+    size_t          rowStride;      ///< floats per row
+    
+    RadianceImage()
+    : data(NULL), width(0), height(0), pixelStride(3), rowStride(0)
+    {}
+    /// a rowStride of 0 means tightly packed rows
+    RadianceImage(const float* pixels, int w, int h, int stride = 3, size_t rowFloats = 0)
+    : data(pixels), width(w), height(h), pixelStride(stride)
+    , rowStride(rowFloats > 0 ? rowFloats : (size_t)w * stride)
+    {}
+    
+    inline bool IsValid() const { return data != NULL && width > 0 && height > 0; }
+    inline const float* GetRow(int y) const { return data + (size_t)y * rowStride; }
+    inline const float* GetPixel(int x, int y) const { return GetRow(y) + (size_t)x * pixelStride; }
+    /// a rectangular region of this image, sharing its pixels
+    inline RadianceImage GetRegion(int x, int y, int w, int h) const {
+        return RadianceImage(GetPixel(x, y), w, h, pixelStride, rowStride);
+    }
+};
+
+MATH_NS_END
+
+#endif // MATH_RADIANCE_IMAGE_H_
@@ -0,0 +1,161 @@
+//
+//  SHBasis.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "math/SHBasis.h"
+#include "math/SimdFloat.h"
+
+MATH_NS_BEGIN
+
+namespace {
+    
+    inline void store(float v, float* p) { *p = v; }
+    inline void store(const SimdFloat& v, float* p) { v.Store(p); }
+    inline float load(const float* p, float) { return *p; }
+    inline SimdFloat load(const float* p, const SimdFloat&) { return SimdFloat::Load(p); }
+    
+    /**
+     * Constants of the recurrence of the normalized Associated Legendre Polynomials
+     * divided by sin(theta)^m, Q(l,m) = K(l,m)*P(l,m,z)/sin(theta)^m:
+     *   Q(m,m)   = qmm(m)
+     *   Q(m+1,m) = sqrt(2m+3) * z * Q(m,m)
+     *   Q(l,m)   = a(l,m) * (z * Q(l-1,m) - b(l,m) * Q(l-2,m))
+     * Multiplied by Re/Im((x+iy)^m) = sin(theta)^m * cos/sin(m*phi), they are polynomials.
+     * The constants only depend on l and m, so a table of more bands serves any fewer.
+     */
+    struct Recurrence {
+        int numBands;
+        std::vector<float> qmm;     ///< indexed by m
+        std::vector<float> a;       ///< indexed by l*(l+1)+m
+        std::vector<float> b;       ///< indexed by l*(l+1)+m
+        
+        Recurrence(int numBands)
+        : numBands(numBands), qmm(numBands), a(numBands*numBands), b(numBands*numBands)
+        {
+            const double PI = 3.14159265358979323846;
+            double q = sqrt(1.0/(4.0*PI));
+            for (int m=0; m<numBands; ++m) {
+                if (m > 0) q *= -sqrt((2.0*m+1.0)/(2.0*m));
+                qmm[m] = (float)q;
+                for (int l=m+2; l<numBands; ++l) {
+                    a[l*(l+1)+m] = (float)sqrt((4.0*l*l-1.0)/((double)l*l-(double)m*m));
+                    b[l*(l+1)+m] = (float)sqrt(((l-1.0)*(l-1.0)-(double)m*m)/(4.0*(l-1.0)*(l-1.0)-1.0));
+                }
+            }
+        }
+    };
+    
+    /**
+     * Recurrence of at least numBands bands, shared by all calls. It is only
+     * rebuilt when a call needs more bands than the current table holds, and
+     * callers keep their own reference, so a rebuild doesn't affect them.
+     */
+    std::shared_ptr<const Recurrence> getRecurrence(int numBands)
+    {
+        static std::mutex s_mutex;
+        static std::shared_ptr<const Recurrence> s_recurrence;
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (!s_recurrence || s_recurrence->numBands < numBands) {
+            s_recurrence = std::make_shared<const Recurrence>(numBands);
+        }
+        return s_recurrence;
+    }
+    
+    /// Basis of any number of bands; x, y, z as in SHBasis (y is the polar axis)
+    template <typename T>
+    void evalRecurrence(const Recurrence& rc, int numBands, const T& x, const T& y, const T& z,
+                        float* out, size_t outStride)
+    {
+        const T sqrt2(1.4142135623730951);
+        // (X + iY)^m with X = sin(theta)cos(phi) = z, Y = sin(theta)sin(phi) = x
+        T cm(1.0), sm(0.0);
+        for (int m=0; m<numBands; ++m) {
+            if (m > 0) {
+                const T c = z * cm - x * sm;
+                sm = z * sm + x * cm;
+                cm = c;
+            }
+            const T cs = sqrt2 * cm;
+            const T ss = sqrt2 * sm;
+            T q2(0.0);
+            T q1(rc.qmm[m]);
+            for (int l=m; l<numBands; ++l) {
+                T q;
+                if (l == m) {
+                    q = q1;
+                } else {
+                    if (l == m+1) {
+                        q = T(sqrt(2.0*m+3.0)) * y * q1;
+                    } else {
+                        const int i = l*(l+1)+m;
+                        q = T(rc.a[i]) * (y * q1 - T(rc.b[i]) * q2);
+                    }
+                    q2 = q1;
+                    q1 = q;
+                }
+                const size_t index = l*(l+1);
+                if (m == 0) {
+                    store(q, out + index * outStride);
+                } else {
+                    store(q * cs, out + (index + m) * outStride);
+                    store(q * ss, out + (index - m) * outStride);
+                }
+            }
+        }
+    }
+    
+    /// Basis with SHBasis<Bands>, written to out with the given stride
+    template <int Bands, typename T>
+    void evalClosedForm(const T& x, const T& y, const T& z, float* out, size_t outStride)
+    {
+        T v[SHBasis<Bands>::NUM_COEFFS];
+        SHBasis<Bands>::Eval(x, y, z, v);
+        for (int n=0; n<SHBasis<Bands>::NUM_COEFFS; ++n) {
+            store(v[n], out + n * outStride);
+        }
+    }
+    
+    template <typename T>
+    void evalDirection(const Recurrence* rc, int numBands, const float* px, const float* py, const float* pz,
+                       float* out, size_t outStride)
+    {
+        const T x = load(px, T());
+        const T y = load(py, T());
+        const T z = load(pz, T());
+        switch (numBands) {
+            case 1: evalClosedForm<1>(x, y, z, out, outStride); break;
+            case 2: evalClosedForm<2>(x, y, z, out, outStride); break;
+            case 3: evalClosedForm<3>(x, y, z, out, outStride); break;
+            case 4: evalClosedForm<4>(x, y, z, out, outStride); break;
+            default: evalRecurrence(*rc, numBands, x, y, z, out, outStride); break;
+        }
+    }
+    
+} // anonymous namespace
+
+void SHBasisBatch(int numBands, int count, const float* x, const float* y, const float* z,
+                  float* out, size_t outStride)
+{
+    std::shared_ptr<const Recurrence> recurrence;
+    if (numBands > 4) {
+        recurrence = getRecurrence(numBands);
+    }
+    const Recurrence* rc = recurrence.get();
+    int i = 0;
+    for (; i + SimdFloat::WIDTH <= count; i += SimdFloat::WIDTH) {
+        evalDirection<SimdFloat>(rc, numBands, x+i, y+i, z+i, out+i, outStride);
+    }
+    // remainder
+    for (; i < count; ++i) {
+        evalDirection<float>(rc, numBands, x+i, y+i, z+i, out+i, outStride);
+    }
+}
+
+MATH_NS_END
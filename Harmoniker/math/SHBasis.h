@@ -0,0 +1,116 @@
+//
+//  SHBasis.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Ref. "Stupid Spherical Harmonics (SH) Tricks", Peter-Pike Sloan
+//
+
+#ifndef MATH_SH_BASIS_H_
+#define MATH_SH_BASIS_H_
+
+#include <stddef.h>
+#include "math/math_def.h"
+
+MATH_NS_BEGIN
+
+/**
+ * Closed-form constants of the real SH basis, including the Condon-Shortley
+ * phase used by SphericalHarmonics::P, so the values match SphericalHarmonics::SH.
+ */
+namespace shconst {
+    constexpr double B0   = 0.28209479177387814;    ///< 1/2 sqrt(1/pi)
+    constexpr double B1   = 0.48860251190291992;    ///< sqrt(3/(4pi))
+    constexpr double B2_0 = 1.09254843059207907;    ///< 1/2 sqrt(15/pi)
+    constexpr double B2_1 = 0.31539156525252005;    ///< 1/4 sqrt(5/pi)
+    constexpr double B2_2 = 0.54627421529603959;    ///< 1/4 sqrt(15/pi)
+    constexpr double B3_0 = 0.59004358992664352;    ///< 1/4 sqrt(35/(2pi))
+    constexpr double B3_1 = 2.89061144264055406;    ///< 1/2 sqrt(105/pi)
+    constexpr double B3_2 = 0.45704579946446574;    ///< 1/4 sqrt(21/(2pi))
+    constexpr double B3_3 = 0.37317633259011546;    ///< 1/4 sqrt(7/pi)
+    constexpr double B3_4 = 1.44530572132027703;    ///< 1/4 sqrt(105/pi)
+}
+
+/**
+ * SH basis for a number of bands known at compile time, as polynomials of the
+ * unit direction. The direction follows Spherical::ToVector3, i.e. y is the
+ * polar axis: (x,y,z) = (sin(theta)sin(phi), cos(theta), sin(theta)cos(phi)).
+ * Eval is a template on the scalar type, so it can run on float, double or
+ * SIMD vectors; everything is inlined and unrolled.
+ * Results are indexed by l*(l+1)+m. Only 1 to 4 bands are specialized; use
+ * SphericalHarmonics::SHAll for other band counts.
+ */
+template <int Bands>
+struct SHBasis;
+
+template <>
+struct SHBasis<1> {
+    static const int NUM_COEFFS = 1;
+    template <typename T>
+    static inline void Eval(const T& /*x*/, const T& /*y*/, const T& /*z*/, T* out) {
+        out[0] = T(shconst::B0);
+    }
+};
+
+template <>
+struct SHBasis<2> {
+    static const int NUM_COEFFS = 4;
+    template <typename T>
+    static inline void Eval(const T& x, const T& y, const T& z, T* out) {
+        SHBasis<1>::Eval(x, y, z, out);
+        out[1] = T(-shconst::B1) * x;
+        out[2] = T(shconst::B1) * y;
+        out[3] = T(-shconst::B1) * z;
+    }
+};
+
+template <>
+struct SHBasis<3> {
+    static const int NUM_COEFFS = 9;
+    template <typename T>
+    static inline void Eval(const T& x, const T& y, const T& z, T* out) {
+        SHBasis<2>::Eval(x, y, z, out);
+        const T y2 = y * y;
+        out[4] = T(shconst::B2_0) * z * x;
+        out[5] = T(-shconst::B2_0) * x * y;
+        out[6] = T(shconst::B2_1) * (T(3.0) * y2 - T(1.0));
+        out[7] = T(-shconst::B2_0) * z * y;
+        out[8] = T(shconst::B2_2) * (z * z - x * x);
+    }
+};
+
+template <>
+struct SHBasis<4> {
+    static const int NUM_COEFFS = 16;
+    template <typename T>
+    static inline void Eval(const T& x, const T& y, const T& z, T* out) {
+        SHBasis<3>::Eval(x, y, z, out);
+        const T x2 = x * x;
+        const T z2 = z * z;
+        const T fy = T(5.0) * y * y - T(1.0);
+        out[9]  = T(-shconst::B3_0) * x * (T(3.0) * z2 - x2);
+        out[10] = T(shconst::B3_1) * z * x * y;
+        out[11] = T(-shconst::B3_2) * x * fy;
+        out[12] = T(shconst::B3_3) * y * (T(5.0) * y * y - T(3.0));
+        out[13] = T(-shconst::B3_2) * z * fy;
+        out[14] = T(shconst::B3_4) * y * (z2 - x2);
+        out[15] = T(-shconst::B3_0) * z * (z2 - T(3.0) * x2);
+    }
+};
+
+/**
+ * Evaluates the SH basis of numBands bands for count directions, processing
+ * SimdFloat::WIDTH directions (8 with AVX2, 4 with SSE) per iteration.
+ * The directions are given as packed x, y, z arrays (see SHBasis), and the
+ * output is structure-of-arrays: coefficient n of direction i is written to
+ * out[n * outStride + i].
+ * Up to 4 bands it runs SHBasis; otherwise it uses a polynomial recurrence
+ * equivalent to SphericalHarmonics::SHAll, with no trigonometry per direction.
+ */
+void SHBasisBatch(int numBands, int count, const float* x, const float* y, const float* z,
+                  float* out, size_t outStride);
+
+MATH_NS_END
+
+#endif // MATH_SH_BASIS_H_
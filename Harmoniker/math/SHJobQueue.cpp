@@ -0,0 +1,271 @@
+//
+//  SHJobQueue.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include "math/SHJobQueue.h"
+#include "math/Parallel.h"
+#include "math/SHStreamProjector.h"
+
+MATH_NS_BEGIN
+
+// ===========================================================
+// SHJob
+// ===========================================================
+
+SHJob::SHJob(const WorkFn& work)
+: m_work(work)
+, m_state(SH_JOB_PENDING)
+, m_progress(0.f)
+, m_cancelRequested(false)
+{
+}
+
+SHJobState SHJob::GetState() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state;
+}
+
+bool SHJob::IsFinished() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state >= SH_JOB_DONE;
+}
+
+std::shared_ptr<SphericalHarmonics> SHJob::GetResult() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_result;
+}
+
+std::string SHJob::GetError() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+void SHJob::Cancel()
+{
+    m_cancelRequested.store(true);
+    bool cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_state == SH_JOB_PENDING) {
+            m_state = SH_JOB_CANCELLED;
+            cancelled = true;
+        }
+    }
+    if (cancelled) {
+        m_finished.notify_all();
+    }
+}
+
+bool SHJob::Wait() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this]() { return m_state >= SH_JOB_DONE; });
+    return m_state == SH_JOB_DONE;
+}
+
+bool SHJob::WaitFor(double seconds) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_finished.wait_for(lock, std::chrono::duration<double>(seconds),
+                               [this]() { return m_state >= SH_JOB_DONE; });
+}
+
+/**
+ * Runs the work function, unless the job was cancelled while it was pending.
+ * An exception of the work function fails the job, instead of terminating the process.
+ */
+void SHJob::run()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_state != SH_JOB_PENDING) return;
+        m_state = SH_JOB_RUNNING;
+    }
+    std::shared_ptr<SphericalHarmonics> result;
+    std::string error;
+    try {
+        result = m_work(*this);
+    } catch (const std::exception& e) {
+        error = e.what();
+        if (error.empty()) error = "exception";
+    } catch (...) {
+        error = "unknown exception";
+    }
+    if (!error.empty()) {
+        finish(SH_JOB_FAILED, std::shared_ptr<SphericalHarmonics>(), error);
+    } else if (IsCancelRequested()) {
+        finish(SH_JOB_CANCELLED, std::shared_ptr<SphericalHarmonics>());
+    } else if (!result) {
+        finish(SH_JOB_FAILED, result);
+    } else {
+        SetProgress(1.f);
+        finish(SH_JOB_DONE, result);
+    }
+    m_work = WorkFn(); // release whatever the work function holds
+}
+
+void SHJob::finish(SHJobState state, const std::shared_ptr<SphericalHarmonics>& result, const std::string& error)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_state = state;
+        m_result = result;
+        m_error = error;
+    }
+    m_finished.notify_all();
+}
+
+// ===========================================================
+// SHJobQueue
+// ===========================================================
+
+SHJobQueue::SHJobQueue(int numWorkers)
+: m_stopping(false)
+{
+    numWorkers = ResolveNumThreads(numWorkers);
+    m_workers.reserve(numWorkers);
+    for (int i=0; i<numWorkers; ++i) {
+        m_workers.push_back(std::thread(&SHJobQueue::workerLoop, this));
+    }
+}
+
+SHJobQueue::~SHJobQueue()
+{
+    CancelAll();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+    for (size_t i=0; i<m_workers.size(); ++i) {
+        m_workers[i].join();
+    }
+}
+
+int SHJobQueue::GetNumPending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (int)m_pending.size();
+}
+
+std::shared_ptr<SHJob> SHJobQueue::Submit(const SHJob::WorkFn& work)
+{
+    std::shared_ptr<SHJob> job = std::make_shared<SHJob>(work);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back(job);
+    }
+    m_wakeUp.notify_one();
+    return job;
+}
+
+/**
+ * The function is evaluated a block of SAMPLES_PER_BLOCK samples at a time,
+ * checking for cancellation in between; that is usually the expensive part.
+ * The projection itself is the same ProjectRadiance call of ProjectPolarFn.
+ */
+std::shared_ptr<SHJob> SHJobQueue::SubmitPolarFn(const SHJobDesc& desc, const RadianceFn& fn)
+{
+    return Submit([desc, fn](SHJob& job) {
+        std::shared_ptr<SphericalHarmonics> sh =
+            std::make_shared<SphericalHarmonics>(desc.numBands, desc.generator, desc.numSamples, desc.seed);
+        sh->SetNumThreads(desc.numThreads);
+        const int numSamples = sh->GetNumSamples();
+        const float* theta = sh->GetSamples().GetTheta();
+        const float* phi = sh->GetSamples().GetPhi();
+        std::vector<Vector3> radiance(numSamples);
+        for (int begin = 0; begin < numSamples; begin += SphericalHarmonics::SAMPLES_PER_BLOCK) {
+            if (job.IsCancelRequested()) {
+                return std::shared_ptr<SphericalHarmonics>();
+            }
+            const int end = std::min(begin + SphericalHarmonics::SAMPLES_PER_BLOCK, numSamples);
+            for (int i=begin; i<end; ++i) {
+                radiance[i] = fn(theta[i], phi[i]);
+            }
+            job.SetProgress((float)end / (float)numSamples);
+        }
+        sh->ProjectRadiance(&radiance[0]);
+        return sh;
+    });
+}
+
+/**
+ * The map is fed to an SHStreamProjector ROWS_PER_STEP rows at a time, so the
+ * result is bit-identical to ProjectEquirect and the job can stop between steps.
+ */
+std::shared_ptr<SHJob> SHJobQueue::SubmitEquirect(const SHJobDesc& desc, const RadianceImage& image)
+{
+    return Submit([desc, image](SHJob& job) {
+        if (!image.IsValid() || image.width % 2 != 0) {
+            return std::shared_ptr<SphericalHarmonics>();
+        }
+        std::shared_ptr<SphericalHarmonics> sh =
+            std::make_shared<SphericalHarmonics>(desc.numBands, SphericalHarmonics::TEXELS_ONLY);
+        sh->SetNumThreads(desc.numThreads);
+        SHStreamProjector projector(sh.get(), image.width, image.height);
+        for (int y = 0; y < image.height; y += ROWS_PER_STEP) {
+            if (job.IsCancelRequested()) {
+                return std::shared_ptr<SphericalHarmonics>();
+            }
+            const int rows = std::min(ROWS_PER_STEP, image.height - y);
+            if (!projector.AddRows(image.GetRegion(0, y, image.width, rows))) {
+                return std::shared_ptr<SphericalHarmonics>();
+            }
+            job.SetProgress((float)(y + rows) / (float)image.height);
+        }
+        projector.Finish();
+        return sh;
+    });
+}
+
+void SHJobQueue::CancelAll()
+{
+    std::vector<std::shared_ptr<SHJob> > jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        jobs.assign(m_pending.begin(), m_pending.end());
+        jobs.insert(jobs.end(), m_running.begin(), m_running.end());
+        m_pending.clear();
+    }
+    for (size_t i=0; i<jobs.size(); ++i) {
+        jobs[i]->Cancel();
+    }
+    m_idle.notify_all();
+}
+
+void SHJobQueue::WaitAll()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_pending.empty() && m_running.empty(); });
+}
+
+void SHJobQueue::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wakeUp.wait(lock, [this]() { return m_stopping || !m_pending.empty(); });
+        if (m_pending.empty()) {
+            return; // stopping
+        }
+        std::shared_ptr<SHJob> job = m_pending.front();
+        m_pending.pop_front();
+        m_running.push_back(job);
+        lock.unlock();
+        job->run();
+        lock.lock();
+        m_running.erase(std::find(m_running.begin(), m_running.end(), job));
+        m_idle.notify_all();
+    }
+}
+
+MATH_NS_END
@@ -0,0 +1,150 @@
+//
+//  SHJobQueue.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_SH_JOB_QUEUE_H_
+#define MATH_SH_JOB_QUEUE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "math/SphericalHarmonics.h"
+
+MATH_NS_BEGIN
+
+/// Life cycle of an SHJob
+enum SHJobState {
+    SH_JOB_PENDING,     ///< waiting for a worker
+    SH_JOB_RUNNING,     ///< being computed
+    SH_JOB_DONE,        ///< finished; the result is available
+    SH_JOB_CANCELLED,   ///< cancelled before it finished
+    SH_JOB_FAILED       ///< the work function returned no result or threw
+};
+
+/// Parameters of the SphericalHarmonics a job creates
+struct SHJobDesc {
+    int             numBands;       ///< Number of bands
+    SampleGenerator generator;      ///< How the sample directions are placed (only used by polar functions)
+    int             numSamples;     ///< Number of samples (only used by polar functions)
+    uint32_t        seed;           ///< Randomization of the sample directions (only used by polar functions)
+    int             numThreads;     ///< Threads of a single job; the queue already runs several jobs at once
+
+    SHJobDesc(int bands = 3, SampleGenerator gen = SAMPLE_GENERATOR_FIBONACCI, int samples = 10000, uint32_t s = 0)
+    : numBands(bands), generator(gen), numSamples(samples), seed(s), numThreads(1)
+    {}
+};
+
+/**
+ *  Handle of a projection submitted to an SHJobQueue. It can be polled for
+ *  its state and progress from any thread, cancelled, or waited for.
+ *  Work functions receive the job, so they can report their progress and
+ *  stop early when a cancellation has been requested.
+ */
+class SHJob {
+public:
+    /// Computes the result; returns NULL if it was cancelled or failed
+    typedef std::function<std::shared_ptr<SphericalHarmonics>(SHJob& job)> WorkFn;
+
+    explicit SHJob(const WorkFn& work);
+
+    // -----------------------------------------------------------
+    // getters
+    // -----------------------------------------------------------
+    SHJobState GetState() const;
+    /// Fraction of the work done, in [0, 1]
+    inline float GetProgress() const { return m_progress.load(); }
+    inline bool IsCancelRequested() const { return m_cancelRequested.load(); }
+    /// Whether the job is done, cancelled or failed
+    bool IsFinished() const;
+    /// The coefficients of a job that is done; NULL otherwise
+    std::shared_ptr<SphericalHarmonics> GetResult() const;
+    /// What the work function of a failed job threw; empty otherwise
+    std::string GetError() const;
+
+    /// Asks the job to stop; a pending job is cancelled right away, a running one when it next checks
+    void Cancel();
+    /// Blocks until the job finishes; returns whether it is done
+    bool Wait() const;
+    /// Blocks until the job finishes or the time runs out; returns whether it finished
+    bool WaitFor(double seconds) const;
+
+    /// Called by work functions, as often as convenient
+    inline void SetProgress(float progress) { m_progress.store(progress); }
+
+private:
+    void run();
+    void finish(SHJobState state, const std::shared_ptr<SphericalHarmonics>& result, const std::string& error = std::string());
+
+    friend class SHJobQueue;
+
+private:
+    WorkFn                      m_work;             ///< what computes the result
+    SHJobState                  m_state;            ///< guarded by m_mutex
+    std::shared_ptr<SphericalHarmonics> m_result;   ///< guarded by m_mutex
+    std::string                 m_error;            ///< guarded by m_mutex
+    std::atomic<float>          m_progress;         ///< fraction of the work done
+    std::atomic<bool>           m_cancelRequested;  ///< set by Cancel
+    mutable std::mutex          m_mutex;
+    mutable std::condition_variable m_finished;     ///< notified when the job finishes
+}; // SHJob
+
+/**
+ *  A pool of worker threads that computes SH projections in the background.
+ *  Jobs are started in submission order, as workers become free, and several
+ *  jobs run at once, each one with SHJobDesc::numThreads threads of its own.
+ *  The queue can be shared by all the users of a process.
+ */
+class SHJobQueue {
+public:
+    /// Radiance of a direction, as in SphericalHarmonics::polarFn, but it can carry state
+    typedef std::function<Vector3(double theta, double phi)> RadianceFn;
+    /// Rows of an image integrated between progress checks
+    static const int ROWS_PER_STEP = 4 * SphericalHarmonics::ROWS_PER_TASK;
+
+    /// @param numWorkers jobs run at once (0 = all hardware threads)
+    explicit SHJobQueue(int numWorkers = 0);
+    /// Cancels the jobs that did not finish and waits for the workers
+    ~SHJobQueue();
+
+    inline int GetNumWorkers() const { return (int)m_workers.size(); }
+    /// Jobs waiting for a worker
+    int GetNumPending() const;
+
+    /// Runs any work function in the pool
+    std::shared_ptr<SHJob> Submit(const SHJob::WorkFn& work);
+    /// Projects a function evaluated at the sample directions, as SphericalHarmonics::ProjectPolarFn
+    std::shared_ptr<SHJob> SubmitPolarFn(const SHJobDesc& desc, const RadianceFn& fn);
+    /// Integrates every texel of an equirectangular map, as SphericalHarmonics::ProjectEquirect;
+    /// only the band count and threads of desc are used, and the pixels must stay alive until the job finishes
+    std::shared_ptr<SHJob> SubmitEquirect(const SHJobDesc& desc, const RadianceImage& image);
+
+    /// Cancels every job that did not finish
+    void CancelAll();
+    /// Blocks until every job submitted so far finishes
+    void WaitAll();
+
+private:
+    void workerLoop();
+
+private:
+    std::vector<std::thread>            m_workers;      ///< pool threads
+    std::deque<std::shared_ptr<SHJob> > m_pending;      ///< jobs waiting for a worker
+    std::vector<std::shared_ptr<SHJob> > m_running;     ///< jobs being computed
+    bool                                m_stopping;     ///< set by the destructor
+    mutable std::mutex                  m_mutex;        ///< guards the members above
+    std::condition_variable             m_wakeUp;       ///< notified when there is work or the queue stops
+    std::condition_variable             m_idle;         ///< notified when a job finishes
+}; // SHJobQueue
+
+MATH_NS_END
+
+#endif // MATH_SH_JOB_QUEUE_H_
@@ -0,0 +1,314 @@
+//
+//  SHSampleSet.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <new>
+#include "math/SHSampleSet.h"
+#include "math/Common.h"
+#include "math/Parallel.h"
+#include "math/SHBasis.h"
+#include "math/Spherical.h"
+
+MATH_NS_BEGIN
+
+namespace {
+    const char MAGIC[4] = { 'V', 'D', 'S', 'S' };
+    
+    /// Header of a sample file; the arena follows at ARENA_OFFSET, so it stays aligned when mapped
+    struct SampleFileHeader {
+        char        magic[4];       ///< "VDSS"
+        uint32_t    version;        ///< FILE_VERSION
+        uint32_t    numBands;
+        uint32_t    numSamples;
+        uint32_t    generator;
+        uint32_t    seed;
+        uint32_t    stride;         ///< floats per array
+        uint32_t    floatOne;       ///< bits of 1.0f, to reject other byte orders
+        uint64_t    arenaSize;      ///< bytes
+    };
+    const size_t ARENA_OFFSET = SHSampleSet::ALIGNMENT;
+    
+    struct SetKey {
+        int numBands;
+        int numSamples;
+        int generator;
+        uint32_t seed;
+        bool operator<(const SetKey& rhs) const {
+            if (numBands != rhs.numBands) return numBands < rhs.numBands;
+            if (numSamples != rhs.numSamples) return numSamples < rhs.numSamples;
+            if (generator != rhs.generator) return generator < rhs.generator;
+            return seed < rhs.seed;
+        }
+    };
+    
+    inline uint32_t floatBits(float f) {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+    
+    inline int computeStride(int numSamples) {
+        const int floatsPerLine = SHSampleSet::ALIGNMENT / sizeof(float);
+        return ((numSamples + floatsPerLine - 1) / floatsPerLine) * floatsPerLine;
+    }
+    
+    std::string cachePath(const std::string& directory, int numBands, int numSamples, SampleGenerator generator, uint32_t seed) {
+        char name[96];
+        snprintf(name, sizeof(name), "sh_b%d_n%d_%s_s%u.shs", numBands, numSamples, GetSampleGeneratorName(generator), seed);
+        return directory + "/" + name;
+    }
+    
+    typedef std::shared_future<std::shared_ptr<const SHSampleSet> > SetFuture;
+    
+    std::mutex g_cacheMutex;
+    std::map<SetKey, SetFuture> g_cache;    ///< an entry is added before its set is ready
+    std::string g_cacheDirectory;
+}
+
+/**
+ * In a process, the sets are shared per parameters. With a cache directory,
+ * a set that is not in memory is mapped from its file, or generated and
+ * written there for the next runs. The file is written to a temporary name
+ * and renamed, so concurrent runs never map a partial file.
+ * The first caller of a set inserts a placeholder and builds the set without
+ * holding the cache lock; other callers of the same set wait for it, and
+ * callers of other sets are not blocked.
+ */
+std::shared_ptr<const SHSampleSet> SHSampleSet::Get(int numBands, int numSamples, SampleGenerator generator, uint32_t seed, int numThreads)
+{
+    SetKey key = { numBands, numSamples, generator, seed };
+    std::promise<std::shared_ptr<const SHSampleSet> > promise;
+    SetFuture pending;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(g_cacheMutex);
+        std::map<SetKey, SetFuture>::iterator it = g_cache.find(key);
+        if (it != g_cache.end()) {
+            pending = it->second;
+        } else {
+            g_cache[key] = promise.get_future().share();
+            if (!g_cacheDirectory.empty()) {
+                path = cachePath(g_cacheDirectory, numBands, numSamples, generator, seed);
+            }
+        }
+    }
+    if (pending.valid()) {
+        return pending.get();
+    }
+    std::shared_ptr<const SHSampleSet> set;
+    try {
+        if (!path.empty()) {
+            set = Map(path.c_str(), numBands, numSamples, generator, seed);
+        }
+        if (!set) {
+            std::shared_ptr<SHSampleSet> generated = std::make_shared<SHSampleSet>(numBands, numSamples, generator, seed);
+            generated->Generate(numThreads);
+            if (!path.empty()) {
+                char suffix[32];
+                snprintf(suffix, sizeof(suffix), ".%d.tmp", (int)getpid());
+                const std::string temp = path + suffix;
+                if (!generated->Write(temp.c_str()) || rename(temp.c_str(), path.c_str()) != 0) {
+                    unlink(temp.c_str());
+                }
+            }
+            set = generated;
+        }
+    } catch (...) {
+        // the next caller tries again; the ones already waiting get the exception
+        {
+            std::lock_guard<std::mutex> lock(g_cacheMutex);
+            g_cache.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    promise.set_value(set);
+    return set;
+}
+
+void SHSampleSet::ClearCache()
+{
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    for (auto it = g_cache.begin(); it != g_cache.end(); ) {
+        // sets still being built are kept; a ready one is only referenced by its future
+        if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready
+            && it->second.get().use_count() == 1) {
+            it = g_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SHSampleSet::SetCacheDirectory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    g_cacheDirectory = directory;
+}
+
+std::string SHSampleSet::GetCacheDirectory()
+{
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    return g_cacheDirectory;
+}
+
+std::string SHSampleSet::GetCachePath(int numBands, int numSamples, SampleGenerator generator, uint32_t seed)
+{
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    return cachePath(g_cacheDirectory, numBands, numSamples, generator, seed);
+}
+
+std::shared_ptr<const SHSampleSet> SHSampleSet::Map(const char* path, int numBands, int numSamples, SampleGenerator generator, uint32_t seed)
+{
+    std::shared_ptr<const SHSampleSet> none;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return none;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < ARENA_OFFSET) {
+        close(fd);
+        return none;
+    }
+    const size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (map == MAP_FAILED) {
+        return none;
+    }
+    SampleFileHeader header;
+    memcpy(&header, map, sizeof(header));
+    const int stride = computeStride(numSamples);
+    const size_t arenaSize = (size_t)(5 + numBands * numBands) * stride * sizeof(float);
+    if (memcmp(header.magic, MAGIC, 4) != 0 || header.version != FILE_VERSION
+        || header.numBands != (uint32_t)numBands || header.numSamples != (uint32_t)numSamples
+        || header.generator != (uint32_t)generator || header.seed != seed
+        || header.stride != (uint32_t)stride || header.floatOne != floatBits(1.0f)
+        || header.arenaSize != arenaSize || size - ARENA_OFFSET < arenaSize) {
+        munmap(map, size);
+        return none;
+    }
+    madvise(map, size, MADV_WILLNEED);
+    return std::shared_ptr<const SHSampleSet>(new SHSampleSet(numBands, numSamples, generator, seed, map, size, ARENA_OFFSET));
+}
+
+/**
+ * Allocates the arena. The contents are zeroed, so the padding at the end
+ * of every array does not contribute to any sum.
+ */
+SHSampleSet::SHSampleSet(int numBands, int numSamples, SampleGenerator generator, uint32_t seed)
+: m_numBands(numBands)
+, m_numCoeffs(numBands*numBands)
+, m_numSamples(numSamples)
+, m_stride(computeStride(numSamples))
+, m_generator(generator)
+, m_seed(seed)
+, m_pMap(NULL)
+, m_mapSize(0)
+{
+    m_pArena = (float*)AlignedMalloc(GetSizeInBytes(), ALIGNMENT);
+    if (m_pArena == NULL) {
+        throw std::bad_alloc();
+    }
+    memset(m_pArena, 0, GetSizeInBytes());
+}
+
+/// A set that uses the arena of a mapped file
+SHSampleSet::SHSampleSet(int numBands, int numSamples, SampleGenerator generator, uint32_t seed, void* map, size_t mapSize, size_t arenaOffset)
+: m_pArena((float*)((char*)map + arenaOffset))
+, m_numBands(numBands)
+, m_numCoeffs(numBands*numBands)
+, m_numSamples(numSamples)
+, m_stride(computeStride(numSamples))
+, m_generator(generator)
+, m_seed(seed)
+, m_pMap(map)
+, m_mapSize(mapSize)
+{
+}
+
+SHSampleSet::~SHSampleSet()
+{
+    if (m_pMap != NULL) {
+        munmap(m_pMap, m_mapSize);
+    } else {
+        AlignedFree(m_pArena);
+    }
+}
+
+/**
+ * Places the samples uniformly across the sphere with the sample generator,
+ * and precomputes their basis values. Every block of samples is built by a
+ * separate task, and every sample depends only on its index and the seed,
+ * so the set is the same for any number of threads.
+ */
+void SHSampleSet::Generate(int numThreads)
+{
+    float* sTheta = GetTheta();
+    float* sPhi = GetPhi();
+    float* sX = GetX();
+    float* sY = GetY();
+    float* sZ = GetZ();
+    float* basis = GetBasis(0);
+    const int numTasks = (m_numSamples + SAMPLES_PER_TASK - 1) / SAMPLES_PER_TASK;
+    ParallelFor(numTasks, numThreads, [&](int task) {
+        const int begin = task * SAMPLES_PER_TASK;
+        const int end = std::min(begin + SAMPLES_PER_TASK, m_numSamples);
+        double u[SAMPLES_PER_TASK], v[SAMPLES_PER_TASK];
+        GenerateUnitSquare(m_generator, m_numSamples, m_seed, begin, end, u, v);
+        for (int i=begin; i<end; ++i) {
+            // generate unbiased distribution of spherical coords
+            double theta = acos(1.0 - 2.0 * u[i-begin]);
+            double phi = 2.0 * PI * v[i-begin];
+            Spherical sph(1.0f, (float)theta, (float)phi);
+            sTheta[i] = sph.GetInclination();
+            sPhi[i] = sph.GetAzimuth();
+            // convert spherical coords to unit vector
+            Vector3 vec = sph.ToVector3();
+            sX[i] = vec.GetX();
+            sY[i] = vec.GetY();
+            sZ[i] = vec.GetZ();
+        }
+        // precompute all SH coefficients for the samples of the block
+        SHBasisBatch(m_numBands, end - begin, sX + begin, sY + begin, sZ + begin, basis + begin, m_stride);
+    });
+}
+
+bool SHSampleSet::Write(const char* path) const
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return false;
+    char header[ARENA_OFFSET];
+    memset(header, 0, sizeof(header));
+    SampleFileHeader h;
+    memcpy(h.magic, MAGIC, 4);
+    h.version = FILE_VERSION;
+    h.numBands = m_numBands;
+    h.numSamples = m_numSamples;
+    h.generator = m_generator;
+    h.seed = m_seed;
+    h.stride = m_stride;
+    h.floatOne = floatBits(1.0f);
+    h.arenaSize = GetSizeInBytes();
+    memcpy(header, &h, sizeof(h));
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(m_pArena, GetSizeInBytes(), 1, file) == 1;
+    return fclose(file) == 0 && ok;
+}
+
+MATH_NS_END
@@ -0,0 +1,133 @@
+//
+//  SHSampleSet.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_SH_SAMPLE_SET_H_
+#define MATH_SH_SAMPLE_SET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include "math/math_def.h"
+#include "math/SampleGenerator.h"
+
+MATH_NS_BEGIN
+
+/**
+ *  Sample directions and their precomputed SH basis values, stored as
+ *  structure-of-arrays in a single aligned allocation:
+ *  theta, phi, x, y, z, and then one row of basis values per coefficient.
+ *  Every array is padded to GetStride() floats (the padding is zero), so
+ *  the rows can be streamed with aligned vector loads.
+ *  Sets are immutable once generated, and shared per parameters (@see Get).
+ *  They can also persist in files that later runs map read-only.
+ */
+class SHSampleSet {
+public:
+    /// Alignment, in bytes, of every array
+    static const int ALIGNMENT = 64;
+    /// Samples generated by a single task; fixed so the set is independent of the thread count
+    static const int SAMPLES_PER_TASK = 4096;
+    /// Version of the sample files; bump it whenever the generators or the basis change
+    static const uint32_t FILE_VERSION = 1;
+    
+public:
+    /**
+     * Shared set for the given parameters; it is generated (or read from the
+     * cache directory) only the first time.
+     * @param numThreads threads used to generate it (0 = all hardware threads)
+     */
+    static std::shared_ptr<const SHSampleSet> Get(int numBands, int numSamples, SampleGenerator generator, uint32_t seed, int numThreads = 0);
+    /// Releases the cached sets that are not in use
+    static void ClearCache();
+    /// Directory where sets persist between runs; empty (the default) disables the files
+    static void SetCacheDirectory(const std::string& directory);
+    static std::string GetCacheDirectory();
+    /// File of a set in the cache directory
+    static std::string GetCachePath(int numBands, int numSamples, SampleGenerator generator, uint32_t seed);
+    
+    /// Maps a set written with Write; NULL if the file is missing or its parameters differ
+    static std::shared_ptr<const SHSampleSet> Map(const char* path, int numBands, int numSamples, SampleGenerator generator, uint32_t seed);
+    
+public:
+    /// An empty set (zeroed); Generate fills it. Throws std::bad_alloc if the arena can't be allocated
+    SHSampleSet(int numBands, int numSamples, SampleGenerator generator = SAMPLE_GENERATOR_JITTERED, uint32_t seed = 0);
+    ~SHSampleSet();
+    
+    /// Places the samples with the generator and evaluates their basis, in parallel
+    void Generate(int numThreads);
+    /// Writes the set to a file that Map can read
+    bool Write(const char* path) const;
+    
+    // -----------------------------------------------------------
+    // getters
+    // -----------------------------------------------------------
+    inline int GetNumBands() const { return m_numBands; }
+    inline int GetNumCoeffs() const { return m_numCoeffs; }
+    inline int GetNumSamples() const { return m_numSamples; }
+    inline SampleGenerator GetGenerator() const { return m_generator; }
+    inline uint32_t GetSeed() const { return m_seed; }
+    /// Whether the arrays are mapped from a file
+    inline bool IsMapped() const { return m_pMap != NULL; }
+    /// Number of floats between consecutive arrays (numSamples rounded up)
+    inline int GetStride() const { return m_stride; }
+    /// Size of the arena, in bytes
+    inline size_t GetSizeInBytes() const { return (size_t)(ARRAY_BASIS + m_numCoeffs) * m_stride * sizeof(float); }
+    
+    /// inclination of every sample
+    inline const float* GetTheta() const { return getArray(ARRAY_THETA); }
+    /// azimuth of every sample
+    inline const float* GetPhi() const { return getArray(ARRAY_PHI); }
+    /// unit vector of every sample (@see Spherical::ToVector3)
+    inline const float* GetX() const { return getArray(ARRAY_X); }
+    inline const float* GetY() const { return getArray(ARRAY_Y); }
+    inline const float* GetZ() const { return getArray(ARRAY_Z); }
+    /// basis values of the n-th coefficient (index l*(l+1)+m) for every sample
+    inline const float* GetBasis(int n) const { return getArray(ARRAY_BASIS + n); }
+    
+    // -----------------------------------------------------------
+    // setters (used to fill the set)
+    // -----------------------------------------------------------
+    inline float* GetTheta() { return getArray(ARRAY_THETA); }
+    inline float* GetPhi() { return getArray(ARRAY_PHI); }
+    inline float* GetX() { return getArray(ARRAY_X); }
+    inline float* GetY() { return getArray(ARRAY_Y); }
+    inline float* GetZ() { return getArray(ARRAY_Z); }
+    inline float* GetBasis(int n) { return getArray(ARRAY_BASIS + n); }
+    
+private:
+    enum {
+        ARRAY_THETA = 0,
+        ARRAY_PHI,
+        ARRAY_X,
+        ARRAY_Y,
+        ARRAY_Z,
+        ARRAY_BASIS
+    };
+    inline float* getArray(int a) const { return m_pArena + (size_t)a * m_stride; }
+    
+    SHSampleSet(int numBands, int numSamples, SampleGenerator generator, uint32_t seed, void* map, size_t mapSize, size_t arenaOffset);
+    
+    // non-copyable
+    SHSampleSet(const SHSampleSet&);
+    SHSampleSet& operator=(const SHSampleSet&);
+    
+private:
+    float*  m_pArena;       ///< all the arrays, in a single allocation
+    int     m_numBands;     ///< Number of bands
+    int     m_numCoeffs;    ///< Number of coeffs
+    int     m_numSamples;   ///< Number of samples
+    int     m_stride;       ///< floats per array
+    SampleGenerator m_generator; ///< How the samples were placed
+    uint32_t m_seed;        ///< Randomization of the samples
+    void*   m_pMap;         ///< mapped file, if the arena is not allocated
+    size_t  m_mapSize;      ///< size of the mapped file
+}; // SHSampleSet
+
+MATH_NS_END
+
+#endif // MATH_SH_SAMPLE_SET_H_
@@ -0,0 +1,81 @@
+//
+//  SHStreamProjector.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include "math/SHStreamProjector.h"
+#include "math/Parallel.h"
+
+MATH_NS_BEGIN
+
+SHStreamProjector::SHStreamProjector(SphericalHarmonics* sh, int width, int height)
+: m_sh(sh)
+, m_width(width)
+, m_height(height)
+, m_nextRow(0)
+{
+    m_sum[0].assign(sh->GetNumCoeffs(), Vector3::ZERO);
+    m_sum[1].assign(sh->GetNumCoeffs(), Vector3::ZERO);
+    m_tables[0] = TexelTable::Get(TexelTable::MAPPING_HEMISPHERE_FRONT, width / 2, height);
+    m_tables[1] = TexelTable::Get(TexelTable::MAPPING_HEMISPHERE_BACK, width / 2, height);
+}
+
+/**
+ * The rows are integrated in parallel, each one into its own partial sums,
+ * which are then added in row order, the same as ProjectDualHemisphere does.
+ * The directions and weights come from the same tables, so the result is
+ * the same as ProjectEquirect's.
+ */
+bool SHStreamProjector::AddRows(const RadianceImage& rows)
+{
+    if (!rows.IsValid() || rows.width != m_width) {
+        return false;
+    }
+    const int numCoeffs = m_sh->GetNumCoeffs();
+    const int halfWidth = m_width / 2;
+    const int stride = SphericalHarmonics::texelStride(halfWidth);
+    const int numRows = m_nextRow + rows.height < m_height ? rows.height : m_height - m_nextRow;
+    if (numRows <= 0) return true;
+    
+    // partial sums of every row, front half and back half
+    std::vector<Vector3> partials((size_t)numRows * 2 * numCoeffs, Vector3::ZERO);
+    const int rowsPerTask = SphericalHarmonics::ROWS_PER_TASK;
+    const int numTasks = (numRows + rowsPerTask - 1) / rowsPerTask;
+    ParallelFor(numTasks, m_sh->GetNumThreads(), [&](int task) {
+        std::vector<float> scratch((size_t)(numCoeffs + 7) * stride, 0.f);
+        const int end = (task + 1) * rowsPerTask < numRows ? (task + 1) * rowsPerTask : numRows;
+        for (int r = task * rowsPerTask; r < end; ++r) {
+            const int j = m_nextRow + r;
+            for (int h=0; h<2; ++h) {
+                m_sh->accumulateTexelRow(*m_tables[h], j, 0, rows.GetPixel(h * halfWidth, r), rows.pixelStride,
+                                         halfWidth, stride, &scratch[0], &partials[((size_t)r * 2 + h) * numCoeffs]);
+            }
+        }
+    });
+    for (int r=0; r<numRows; ++r) {
+        for (int h=0; h<2; ++h) {
+            const Vector3* sum = &partials[((size_t)r * 2 + h) * numCoeffs];
+            for (int n=0; n<numCoeffs; ++n) {
+                m_sum[h][n] += sum[n];
+            }
+        }
+    }
+    m_nextRow += numRows;
+    return true;
+}
+
+Vector3* SHStreamProjector::Finish()
+{
+    const int numCoeffs = m_sh->GetNumCoeffs();
+    for (int n=0; n<numCoeffs; ++n) {
+        m_sh->m_pCoeffs[n] = Vector3::ZERO;
+        m_sh->m_pCoeffs[n] += m_sum[0][n];
+        m_sh->m_pCoeffs[n] += m_sum[1][n];
+    }
+    m_sh->computeIrradiance();
+    return m_sh->m_pCoeffs;
+}
+
+MATH_NS_END
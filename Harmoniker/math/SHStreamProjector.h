@@ -0,0 +1,60 @@
+//
+//  SHStreamProjector.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_SH_STREAM_PROJECTOR_H_
+#define MATH_SH_STREAM_PROJECTOR_H_
+
+#include <vector>
+#include "math/SphericalHarmonics.h"
+#include "math/TexelTable.h"
+
+MATH_NS_BEGIN
+
+/**
+ *  Projects an equirectangular map that arrives in scanlines, from top to
+ *  bottom, so the whole image never needs to be in memory. Every scanline is
+ *  integrated as soon as it arrives and can be discarded afterwards; only the
+ *  texel tables (O(width + height)) and the basis of the rows being integrated are kept.
+ *  The result is bit-identical to SphericalHarmonics::ProjectEquirect.
+ */
+class SHStreamProjector {
+public:
+    /**
+     * @param sh where the coefficients are written by Finish; its band count and threads are used
+     * @param width width of the whole map (even)
+     * @param height height of the whole map
+     */
+    SHStreamProjector(SphericalHarmonics* sh, int width, int height);
+    
+    // -----------------------------------------------------------
+    // getters
+    // -----------------------------------------------------------
+    /// Next row expected by AddRows
+    inline int GetNextRow() const { return m_nextRow; }
+    inline bool IsComplete() const { return m_nextRow >= m_height; }
+    
+    /**
+     * Integrates the next rows.height scanlines (rows beyond the height of the map are ignored)
+     * @param rows scanlines of the full width, in the layout of a RadianceImage
+     * @return false, integrating nothing, if rows isn't valid or as wide as the map
+     */
+    bool AddRows(const RadianceImage& rows);
+    /// Writes the coefficients to the SphericalHarmonics (as ProjectEquirect would) and returns them
+    Vector3* Finish();
+    
+private:
+    SphericalHarmonics* m_sh;           ///< band count, threads and output
+    int                 m_width;        ///< width of the map
+    int                 m_height;       ///< height of the map
+    int                 m_nextRow;      ///< rows integrated so far
+    std::vector<Vector3> m_sum[2];      ///< sums of the front & back halves
+    std::shared_ptr<const TexelTable> m_tables[2]; ///< directions & weights of the front & back halves
+}; // SHStreamProjector
+
+MATH_NS_END
+
+#endif // MATH_SH_STREAM_PROJECTOR_H_
@@ -0,0 +1,123 @@
+//
+//  SampleGenerator.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <math.h>
+#include "math/SampleGenerator.h"
+#include "math/CounterRandom.h"
+
+MATH_NS_BEGIN
+
+namespace {
+    /// 2^-32
+    const double INV_2_32 = 1.0 / 4294967296.0;
+    /// 1/φ, φ being the golden ratio
+    const double INV_GOLDEN_RATIO = 0.61803398874989484820;
+    
+    /// Integer hash, to derive the scrambling of each dimension from the seed
+    inline uint32_t hash(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+    
+    inline uint32_t reverseBits(uint32_t x) {
+        x = (x << 16) | (x >> 16);
+        x = ((x & 0x00ff00ffU) << 8) | ((x & 0xff00ff00U) >> 8);
+        x = ((x & 0x0f0f0f0fU) << 4) | ((x & 0xf0f0f0f0U) >> 4);
+        x = ((x & 0x33333333U) << 2) | ((x & 0xccccccccU) >> 2);
+        x = ((x & 0x55555555U) << 1) | ((x & 0xaaaaaaaaU) >> 1);
+        return x;
+    }
+    
+    /// Second dimension of Sobol: generator matrix of the polynomial x + 1
+    inline uint32_t sobol2(uint32_t i) {
+        uint32_t result = 0;
+        for (uint32_t v = 1U << 31; i != 0; i >>= 1, v ^= v >> 1) {
+            if (i & 1) result ^= v;
+        }
+        return result;
+    }
+    
+    /// Scrambled bits to [0,1), with the center of the interval of the bits below 32
+    inline double toUnit(uint32_t bits) {
+        return (bits + 0.5) * INV_2_32;
+    }
+    
+    void jittered(int numSamples, uint32_t seed, int begin, int end, double* u, double* v) {
+        const CounterRandom rng(seed);
+        const int sqrtN = (int)sqrt((double)numSamples);
+        const int numCells = sqrtN * sqrtN;
+        const double oneoverN = 1.0 / sqrtN;
+        for (int i=begin; i<end; ++i) {
+            float ru, rv;
+            rng.GetFloat2((uint32_t)i, &ru, &rv);
+            if (i < numCells) {
+                // cell (a,b) of the grid
+                u[i-begin] = (i / sqrtN + ru) * oneoverN;
+                v[i-begin] = (i % sqrtN + rv) * oneoverN;
+            } else {
+                u[i-begin] = ru;
+                v[i-begin] = rv;
+            }
+        }
+    }
+} // anonymous namespace
+
+const char* GetSampleGeneratorName(SampleGenerator generator)
+{
+    switch (generator) {
+        case SAMPLE_GENERATOR_JITTERED: return "jittered";
+        case SAMPLE_GENERATOR_HAMMERSLEY: return "hammersley";
+        case SAMPLE_GENERATOR_SOBOL: return "sobol";
+        case SAMPLE_GENERATOR_FIBONACCI: return "fibonacci";
+        default: return "unknown";
+    }
+}
+
+/**
+ * Hammersley and Sobol are (0,m,2)-nets in base 2 when N is a power of 2, and
+ * XOR scrambling keeps that property. Fibonacci points are the most uniform
+ * on the sphere for any N, but their error decreases less regularly with N.
+ */
+void GenerateUnitSquare(SampleGenerator generator, int numSamples, uint32_t seed, int begin, int end, double* u, double* v)
+{
+    const uint32_t scrambleU = seed != 0 ? hash(seed) : 0;
+    const uint32_t scrambleV = seed != 0 ? hash(seed ^ 0x9e3779b9U) : 0;
+    switch (generator) {
+        case SAMPLE_GENERATOR_HAMMERSLEY:
+            for (int i=begin; i<end; ++i) {
+                // i/N has fewer than 32 significant bits, so scramble the 32-bit fraction
+                const uint32_t bits = (uint32_t)(((uint64_t)i << 32) / (uint64_t)numSamples);
+                u[i-begin] = toUnit(bits ^ scrambleU);
+                v[i-begin] = toUnit(reverseBits((uint32_t)i) ^ scrambleV);
+            }
+            break;
+        case SAMPLE_GENERATOR_SOBOL:
+            for (int i=begin; i<end; ++i) {
+                u[i-begin] = toUnit(reverseBits((uint32_t)i) ^ scrambleU);
+                v[i-begin] = toUnit(sobol2((uint32_t)i) ^ scrambleV);
+            }
+            break;
+        case SAMPLE_GENERATOR_FIBONACCI: {
+            const double offset = scrambleV * INV_2_32;
+            for (int i=begin; i<end; ++i) {
+                u[i-begin] = (i + 0.5) / numSamples;
+                const double t = i * INV_GOLDEN_RATIO + offset;
+                v[i-begin] = t - floor(t);
+            }
+            break;
+        }
+        default:
+            jittered(numSamples, seed, begin, end, u, v);
+            break;
+    }
+}
+
+MATH_NS_END
@@ -0,0 +1,49 @@
+//
+//  SampleGenerator.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_SAMPLE_GENERATOR_H_
+#define MATH_SAMPLE_GENERATOR_H_
+
+#include <stdint.h>
+#include "math/math_def.h"
+
+MATH_NS_BEGIN
+
+/**
+ *  Point sets in the unit square used to place the samples on the sphere.
+ *  A point (u,v) maps to the direction of inclination acos(1 - 2u) and
+ *  azimuth 2πv, which preserves areas, so uniform points give uniform directions.
+ */
+enum SampleGenerator {
+    /// one random point per cell of a √N x √N grid; the samples that do not fit a square are random
+    SAMPLE_GENERATOR_JITTERED = 0,
+    /// (i/N, radical inverse of i) in base 2
+    SAMPLE_GENERATOR_HAMMERSLEY,
+    /// first two dimensions of the Sobol sequence
+    SAMPLE_GENERATOR_SOBOL,
+    /// Fibonacci lattice, ((i+½)/N, i/φ mod 1): spherical Fibonacci points on the sphere
+    SAMPLE_GENERATOR_FIBONACCI,
+    NUM_SAMPLE_GENERATORS
+};
+
+/// Short lowercase name of a generator ("jittered", "hammersley", "sobol", "fibonacci")
+const char* GetSampleGeneratorName(SampleGenerator generator);
+
+/**
+ * Generates the points [begin, end) of a set of numSamples points of the unit square (any count).
+ * Every point depends only on its index, so ranges can be generated in parallel.
+ * @param seed randomizes the low-discrepancy sets without breaking their structure:
+ * random digit scrambling (XOR) for Hammersley and Sobol, a random azimuth
+ * rotation for Fibonacci; 0 means no randomization. It is the key of the
+ * CounterRandom of the jittered samples.
+ * @param u,v arrays of end - begin values
+ */
+void GenerateUnitSquare(SampleGenerator generator, int numSamples, uint32_t seed, int begin, int end, double* u, double* v);
+
+MATH_NS_END
+
+#endif // MATH_SAMPLE_GENERATOR_H_
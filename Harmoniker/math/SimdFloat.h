@@ -0,0 +1,176 @@
+//
+//  SimdFloat.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_SIMD_FLOAT_H_
+#define MATH_SIMD_FLOAT_H_
+
+#include <math.h>
+#include "math/math_def.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MATH_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATH_SIMD_SSE 1
+#endif
+
+MATH_NS_BEGIN
+
+/**
+ * A vector of WIDTH floats: 8 with AVX2, 4 with SSE, and a single float
+ * otherwise. The instruction set is chosen at compile time (e.g. -mavx2).
+ * It has the arithmetic operators needed to run the scalar templates
+ * (e.g. SHBasis::Eval) on several values at once.
+ */
+class SimdFloat {
+public:
+#if MATH_SIMD_AVX2
+    typedef __m256 Native;
+    static const int WIDTH = 8;
+#elif MATH_SIMD_SSE
+    typedef __m128 Native;
+    static const int WIDTH = 4;
+#else
+    typedef float Native;
+    static const int WIDTH = 1;
+#endif
+    
+public:
+    SimdFloat() {}
+    SimdFloat(Native v) : m_v(v) {}
+    /// all elements set to the same value
+    SimdFloat(double value) : m_v(broadcast((float)value)) {}
+    
+    /// loads WIDTH floats (no alignment needed)
+    static inline SimdFloat Load(const float* p) {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_loadu_ps(p));
+#elif MATH_SIMD_SSE
+        return SimdFloat(_mm_loadu_ps(p));
+#else
+        return SimdFloat(*p);
+#endif
+    }
+    /// stores WIDTH floats (no alignment needed)
+    inline void Store(float* p) const {
+#if MATH_SIMD_AVX2
+        _mm256_storeu_ps(p, m_v);
+#elif MATH_SIMD_SSE
+        _mm_storeu_ps(p, m_v);
+#else
+        *p = m_v;
+#endif
+    }
+    
+    inline SimdFloat operator+(const SimdFloat& rhs) const {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_add_ps(m_v, rhs.m_v));
+#elif MATH_SIMD_SSE
+        return SimdFloat(_mm_add_ps(m_v, rhs.m_v));
+#else
+        return SimdFloat(m_v + rhs.m_v);
+#endif
+    }
+    inline SimdFloat operator-(const SimdFloat& rhs) const {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_sub_ps(m_v, rhs.m_v));
+#elif MATH_SIMD_SSE
+        return SimdFloat(_mm_sub_ps(m_v, rhs.m_v));
+#else
+        return SimdFloat(m_v - rhs.m_v);
+#endif
+    }
+    inline SimdFloat operator*(const SimdFloat& rhs) const {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_mul_ps(m_v, rhs.m_v));
+#elif MATH_SIMD_SSE
+        return SimdFloat(_mm_mul_ps(m_v, rhs.m_v));
+#else
+        return SimdFloat(m_v * rhs.m_v);
+#endif
+    }
+    inline SimdFloat operator/(const SimdFloat& rhs) const {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_div_ps(m_v, rhs.m_v));
+#elif MATH_SIMD_SSE
+        return SimdFloat(_mm_div_ps(m_v, rhs.m_v));
+#else
+        return SimdFloat(m_v / rhs.m_v);
+#endif
+    }
+    inline SimdFloat operator-() const {
+        return SimdFloat(0.0) - *this;
+    }
+    inline SimdFloat& operator+=(const SimdFloat& rhs) {
+        return *this = *this + rhs;
+    }
+    inline SimdFloat& operator*=(const SimdFloat& rhs) {
+        return *this = *this * rhs;
+    }
+    
+    // -----------------------------------------------------------
+    // functions
+    // -----------------------------------------------------------
+    static inline SimdFloat Sqrt(const SimdFloat& a) {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_sqrt_ps(a.m_v));
+#elif MATH_SIMD_SSE
+        return SimdFloat(_mm_sqrt_ps(a.m_v));
+#else
+        return SimdFloat(sqrtf(a.m_v));
+#endif
+    }
+    static inline SimdFloat Min(const SimdFloat& a, const SimdFloat& b) {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_min_ps(a.m_v, b.m_v));
+#elif MATH_SIMD_SSE
+        return SimdFloat(_mm_min_ps(a.m_v, b.m_v));
+#else
+        return SimdFloat(a.m_v < b.m_v ? a.m_v : b.m_v);
+#endif
+    }
+    static inline SimdFloat Max(const SimdFloat& a, const SimdFloat& b) {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_max_ps(a.m_v, b.m_v));
+#elif MATH_SIMD_SSE
+        return SimdFloat(_mm_max_ps(a.m_v, b.m_v));
+#else
+        return SimdFloat(a.m_v > b.m_v ? a.m_v : b.m_v);
+#endif
+    }
+    /// element-wise (a > b) ? ifGreater : otherwise
+    static inline SimdFloat SelectGreater(const SimdFloat& a, const SimdFloat& b,
+                                          const SimdFloat& ifGreater, const SimdFloat& otherwise) {
+#if MATH_SIMD_AVX2
+        return SimdFloat(_mm256_blendv_ps(otherwise.m_v, ifGreater.m_v, _mm256_cmp_ps(a.m_v, b.m_v, _CMP_GT_OQ)));
+#elif MATH_SIMD_SSE
+        const __m128 mask = _mm_cmpgt_ps(a.m_v, b.m_v);
+        return SimdFloat(_mm_or_ps(_mm_and_ps(mask, ifGreater.m_v), _mm_andnot_ps(mask, otherwise.m_v)));
+#else
+        return SimdFloat(a.m_v > b.m_v ? ifGreater.m_v : otherwise.m_v);
+#endif
+    }
+    
+private:
+    static inline Native broadcast(float value) {
+#if MATH_SIMD_AVX2
+        return _mm256_set1_ps(value);
+#elif MATH_SIMD_SSE
+        return _mm_set1_ps(value);
+#else
+        return value;
+#endif
+    }
+    
+private:
+    Native m_v;
+}; // SimdFloat
+
+MATH_NS_END
+
+#endif // MATH_SIMD_FLOAT_H_
@@ -9,39 +9,216 @@
 //
 
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
 #include "SphericalHarmonics.h"
+#include "math/Parallel.h"
+#include "math/SHBasis.h"
+#include "math/SimdFloat.h"
+#include "math/TexelTable.h"
 
 MATH_NS_BEGIN
 
+namespace {
+    /// Number of independent accumulators per basis row in the projection kernels
+    const int LANES = 8;
+    /// Directions evaluated at once by evaluateBatch
+    const int EVAL_CHUNK = 64;
+    /// Basis rows that evaluateBatch keeps on the stack (5 bands)
+    const int EVAL_STACK_COEFFS = 25;
+    const double PI_D = 3.14159265358979323846;
+    
+    /**
+     * Adds the product of a tile of every basis row with the planar radiance r, g, b.
+     * NumCoeffs is the number of rows when known at compile time (fully unrolled),
+     * or 0 to use numCoeffs. paddedCount is a multiple of Lanes.
+     * The accumulators are explicit vectors: with plain arrays, -O3 splits the
+     * lanes into a different loop nest that is about 3 times slower than -O2.
+     */
+    template <int NumCoeffs, int Lanes>
+    void accumulateTile(const float* basisRows, size_t basisStride, int numCoeffs, int paddedCount,
+                        const float* r, const float* g, const float* b, Vector3* sum)
+    {
+        const int Vectors = Lanes / SimdFloat::WIDTH;
+        const int nc = NumCoeffs > 0 ? NumCoeffs : numCoeffs;
+        for (int n = 0; n < nc; ++n) {
+            // rows are padded with zeros up to the stride, so reading past the sample count is safe
+            const float* basis = basisRows + n * basisStride;
+            SimdFloat accR[Vectors], accG[Vectors], accB[Vectors];
+            for (int v = 0; v < Vectors; ++v) {
+                accR[v] = accG[v] = accB[v] = SimdFloat(0.0);
+            }
+            for (int i = 0; i < paddedCount; i += Lanes) {
+#pragma GCC unroll 8
+                for (int v = 0; v < Vectors; ++v) {
+                    const int offset = i + v * SimdFloat::WIDTH;
+                    const SimdFloat y = SimdFloat::Load(basis + offset);
+                    accR[v] += y * SimdFloat::Load(r + offset);
+                    accG[v] += y * SimdFloat::Load(g + offset);
+                    accB[v] += y * SimdFloat::Load(b + offset);
+                }
+            }
+            float lanes[3][Lanes];
+            for (int v = 0; v < Vectors; ++v) {
+                accR[v].Store(lanes[0] + v * SimdFloat::WIDTH);
+                accG[v].Store(lanes[1] + v * SimdFloat::WIDTH);
+                accB[v].Store(lanes[2] + v * SimdFloat::WIDTH);
+            }
+            Vector3 tile(0.f);
+            for (int k = 0; k < Lanes; ++k) {
+                tile += Vector3(lanes[0][k], lanes[1][k], lanes[2][k]);
+            }
+            sum[n] += tile;
+        }
+    }
+    
+    /**
+     * accumulateTile for Probes radiance buffers at once: every basis value is
+     * loaded once and multiplied by the radiance of all of them. The products of
+     * every probe are added in the same order as in accumulateTile, so the
+     * results are the same. The accumulators are explicit vectors, and the
+     * unroll pragmas keep them in registers at any optimization level.
+     * @param planar Probes groups of r, g, b arrays of tileStride floats
+     * @param sums Probes arrays of numCoeffs sums
+     */
+    template <int NumCoeffs, int Lanes, int Probes>
+    void accumulateTileProbes(const float* basisRows, size_t basisStride, int numCoeffs, int paddedCount,
+                              const float* planar, int tileStride, Vector3* const* sums)
+    {
+        const int Vectors = Lanes / SimdFloat::WIDTH;
+        const int Channels = 3 * Probes;
+        const int nc = NumCoeffs > 0 ? NumCoeffs : numCoeffs;
+        for (int n = 0; n < nc; ++n) {
+            const float* basis = basisRows + n * basisStride;
+            SimdFloat acc[Channels * Vectors];
+            for (int a = 0; a < Channels * Vectors; ++a) {
+                acc[a] = SimdFloat(0.0);
+            }
+            for (int i = 0; i < paddedCount; i += Lanes) {
+#pragma GCC unroll 8
+                for (int v = 0; v < Vectors; ++v) {
+                    const int offset = i + v * SimdFloat::WIDTH;
+                    const SimdFloat y = SimdFloat::Load(basis + offset);
+#pragma GCC unroll 16
+                    for (int c = 0; c < Channels; ++c) {
+                        acc[c * Vectors + v] += y * SimdFloat::Load(planar + c * tileStride + offset);
+                    }
+                }
+            }
+            for (int p = 0; p < Probes; ++p) {
+                float lanes[3][Lanes];
+                for (int c = 0; c < 3; ++c) {
+                    for (int v = 0; v < Vectors; ++v) {
+                        acc[(3 * p + c) * Vectors + v].Store(lanes[c] + v * SimdFloat::WIDTH);
+                    }
+                }
+                Vector3 tile(0.f);
+                for (int k = 0; k < Lanes; ++k) {
+                    tile += Vector3(lanes[0][k], lanes[1][k], lanes[2][k]);
+                }
+                sums[p][n] += tile;
+            }
+        }
+    }
+    
+    /// Sum of coeffs[n] * Y_n(direction) for a fixed number of bands
+    template <int Bands>
+    Vector3 reconstruct(const Vector3* coeffs, const Vector3& d) {
+        float basis[SHBasis<Bands>::NUM_COEFFS];
+        SHBasis<Bands>::Eval(d.GetX(), d.GetY(), d.GetZ(), basis);
+        Vector3 v(0.f);
+        for (int n = 0; n < SHBasis<Bands>::NUM_COEFFS; ++n) {
+            v += coeffs[n] * basis[n];
+        }
+        return v;
+    }
+    
+    inline void store(float v, float* p) { *p = v; }
+    inline void store(const SimdFloat& v, float* p) { v.Store(p); }
+    inline float load(const float* p, float) { return *p; }
+    inline SimdFloat load(const float* p, const SimdFloat&) { return SimdFloat::Load(p); }
+    
+    /// Irradiance of one channel, from the coefficients of its quadratic form (@see IRRADIANCE_FORM_SIZE)
+    template <typename T>
+    inline T evalIrradiance(const float* c, const T& x, const T& y, const T& z) {
+        return x * (T(c[0]) * x + T(c[1]) * y + T(c[2]) * z + T(c[3]))
+        + y * (T(c[4]) * y + T(c[5]) * z + T(c[6]))
+        + z * (T(c[7]) * z + T(c[8]))
+        + T(c[9]);
+    }
+    
+    template <typename T>
+    inline void evalIrradiance(const float form[][SphericalHarmonics::IRRADIANCE_FORM_SIZE],
+                               const float* nx, const float* ny, const float* nz,
+                               float* r, float* g, float* b) {
+        const T x = load(nx, T()), y = load(ny, T()), z = load(nz, T());
+        store(evalIrradiance(form[0], x, y, z), r);
+        store(evalIrradiance(form[1], x, y, z), g);
+        store(evalIrradiance(form[2], x, y, z), b);
+    }
+} // anonymous namespace
+
 /** 
  * Constructor
  * @param numBands Number of Bands (default = 3)
- * @param numSamplesSqr Sqrt of number of samples (default = 500)
+ * @param numSamplesSqr Sqrt of number of samples (default = 500), placed with jittered stratification
  */
 SphericalHarmonics::SphericalHarmonics(int numBands, int numSamplesSqr)
+: SphericalHarmonics(numBands, SAMPLE_GENERATOR_JITTERED, numSamplesSqr*numSamplesSqr)
+{
+}
+
+/**
+ * Constructor
+ * @param numBands Number of Bands
+ * @param generator how to place the samples on the sphere
+ * @param numSamples Number of samples (any count)
+ * @param seed randomization of the sample set (@see GenerateUnitSquare)
+ */
+SphericalHarmonics::SphericalHarmonics(int numBands, SampleGenerator generator, int numSamples, uint32_t seed)
+: SphericalHarmonics(numBands, TEXELS_ONLY)
+{
+    m_numSamples = numSamples;
+    m_generator = generator;
+    m_seed = seed;
+    m_pSamples = SHSampleSet::Get(m_numBands, m_numSamples, m_generator, m_seed, m_numThreads);
+}
+
+/**
+ * Constructor of an object that only projects texels (ProjectEquirect, ProjectCubeMap,
+ * ProjectDualHemisphere, SHStreamProjector...). No sample set is created, so
+ * the projections of samples do nothing.
+ * @param numBands Number of Bands
+ */
+SphericalHarmonics::SphericalHarmonics(int numBands, TexelsOnly)
 : m_numBands(numBands)
 , m_numCoeffs(numBands*numBands)
-, m_numSamples(numSamplesSqr*numSamplesSqr)
+, m_numSamples(0)
+, m_numThreads(0)
+, m_generator(SAMPLE_GENERATOR_JITTERED)
+, m_seed(0)
+, m_irradianceBands(numBands)
 {
-    m_pSamples = (SHSample*)malloc(m_numSamples*sizeof(SHSample));
-    for (int i=0;i<m_numSamples;++i) {
-        m_pSamples[i].coeff = (double*)malloc(m_numCoeffs*sizeof(double));
-    }
     m_pCoeffs = (Vector3*)malloc(m_numCoeffs*sizeof(Vector3));
+    m_pIrradianceCoeffs = (Vector3*)malloc(m_numCoeffs*sizeof(Vector3));
     for (int i=0;i<m_numCoeffs;++i) {
         m_pCoeffs[i]=Vector3::ZERO;
+        m_pIrradianceCoeffs[i]=Vector3::ZERO;
     }
-    setupSphericalSamples(m_pSamples, numSamplesSqr);
-
+    memset(m_irradianceForm, 0, sizeof(m_irradianceForm));
 }
 
 SphericalHarmonics::~SphericalHarmonics()
 {
-    for (int i=0;i<m_numSamples;++i) {
-        free(m_pSamples[i].coeff);
-    }
-    free(m_pSamples);
     free(m_pCoeffs);
+    free(m_pIrradianceCoeffs);
+}
+
+void SphericalHarmonics::SetIrradianceBands(int numBands)
+{
+    m_irradianceBands = std::max(1, std::min(numBands, m_numBands));
 }
 
 
@@ -71,7 +248,12 @@ double SphericalHarmonics::P(int l,int m,double x)
 /// renormalization constant for SH function
 double SphericalHarmonics::K(int l, int m)
 {
-    double temp = ((2.0*l+1.0)*Factorial(l-m)) / (4.0*PI*Factorial(l+m)); 
+    // (l-m)!/(l+m)! as a product, so it does not overflow for large l
+    double ratio = 1.0;
+    for (int i = l-m+1; i <= l+m; ++i) {
+        ratio /= i;
+    }
+    double temp = ((2.0*l+1.0)*ratio) / (4.0*PI);
     return sqrt(temp);
 }
 /**
@@ -90,52 +272,146 @@ double SphericalHarmonics::SH(int l, int m, double theta, double phi)
     else return sqrt2*K(l,-m)*sin(-m*phi)*P(l,-m,cos(theta));
 }
 
-
 /**
- * @brief Initializes the SHSamples
- * fill an N*N*2 array with uniformly distributed
- * samples across the sphere using jittered stratification
- */
-void SphericalHarmonics::setupSphericalSamples(SHSample* samples, int sqrt_n_samples) {
-    int i=0; // array index
-    double oneoverN = 1.0/sqrt_n_samples;
-    for(int a=0; a<sqrt_n_samples; a++) {
-        for(int b=0; b<sqrt_n_samples; b++) {
-            // generate unbiased distribution of spherical coords
-            double x=(a+Randf())*oneoverN; //do not reuse results
-            double y=(b+Randf())*oneoverN; //each sample must be random
-            double theta = 2.0 * acos(sqrt(1.0 - x));
-            double phi = 2.0 * PI * y;
-            samples[i].sph = Spherical(1.0f, (float)theta, (float)phi);
-            // convert spherical coords to unit vector
-            samples[i].vec = samples[i].sph.ToVector3();
-            // precompute all SH coefficients for this sample
-            for(int l=0; l<m_numBands; ++l) {
-                for(int m=-l; m<=l; ++m) {
-                    int index = l*(l+1)+m;
-                    samples[i].coeff[index] = SH(l,m,theta,phi);
-                }
+ * Evaluates all the SH basis functions of the first numBands bands in O(L^2).
+ * Uses the recurrences of the normalized Associated Legendre Polynomials
+ * N(l,m) = K(l,m)*P(l,m,cos(theta)), and of cos(m*phi), sin(m*phi):
+ *   N(m,m)   = -sqrt((2m+1)/(2m)) * sin(theta) * N(m-1,m-1)
+ *   N(m+1,m) = sqrt(2m+3) * cos(theta) * N(m,m)
+ *   N(l,m)   = a(l,m) * (cos(theta) * N(l-1,m) - b(l,m) * N(l-2,m))
+ * so no factorials are involved and it stays accurate for high band counts.
+ * @param result array of numBands*numBands values, indexed by l*(l+1)+m
+ * @see SH
+ */
+void SphericalHarmonics::SHAll(int numBands, double theta, double phi, double* result)
+{
+    const double sqrt2 = sqrt(2.0);
+    const double x = cos(theta);
+    const double somx2 = sin(theta);
+    const double cosPhi = cos(phi);
+    const double sinPhi = sin(phi);
+    double pmm = sqrt(1.0/(4.0*PI)); // N(0,0)
+    double cosMPhi = 1.0;
+    double sinMPhi = 0.0;
+    for (int m=0; m<numBands; ++m) {
+        if (m>0) {
+            pmm *= -sqrt((2.0*m+1.0)/(2.0*m)) * somx2;
+            const double c = cosMPhi * cosPhi - sinMPhi * sinPhi;
+            sinMPhi = sinMPhi * cosPhi + cosMPhi * sinPhi;
+            cosMPhi = c;
+        }
+        double pll2 = 0.0;  // N(l-2,m)
+        double pll1 = pmm;  // N(l-1,m)
+        for (int l=m; l<numBands; ++l) {
+            double pll;
+            if (l == m) {
+                pll = pmm;
+            } else if (l == m+1) {
+                pll = sqrt(2.0*m+3.0) * x * pmm;
+            } else {
+                const double a = sqrt((4.0*l*l-1.0)/((double)l*l-(double)m*m));
+                const double b = sqrt(((l-1.0)*(l-1.0)-(double)m*m)/(4.0*(l-1.0)*(l-1.0)-1.0));
+                pll = a * (x * pll1 - b * pll2);
+            }
+            if (l > m) {
+                pll2 = pll1;
+                pll1 = pll;
+            }
+            const int index = l*(l+1);
+            if (m == 0) {
+                result[index] = pll;
+            } else {
+                result[index+m] = sqrt2 * pll * cosMPhi;
+                result[index-m] = sqrt2 * pll * sinMPhi;
             }
-            ++i; 
         }
     }
 }
 
+/**
+ * Projects, with the given sample set, a function whose coefficients are known:
+ * a fixed combination of the basis functions of numBands + 2 bands, so that
+ * the error includes the aliasing of the bands that are not projected.
+ * @return root mean square error of the numBands^2 projected coefficients
+ */
+double SphericalHarmonics::MeasureSamplingError(int numBands, SampleGenerator generator, int numSamples, uint32_t seed)
+{
+    const int refBands = numBands + 2;
+    const int refCoeffs = refBands * refBands;
+    std::vector<double> reference(refCoeffs);
+    for (int n=0; n<refCoeffs; ++n) {
+        const int l = (int)sqrt((double)n);
+        reference[n] = cos(1.7 * n + 0.3) / (1.0 + l);
+    }
+    SphericalHarmonics sh(numBands, generator, numSamples, seed);
+    const SHSampleSet& samples = sh.GetSamples();
+    std::vector<Vector3> radiance(numSamples);
+    std::vector<double> basis(refCoeffs);
+    for (int i=0; i<numSamples; ++i) {
+        SHAll(refBands, samples.GetTheta()[i], samples.GetPhi()[i], &basis[0]);
+        double f = 0.0;
+        for (int n=0; n<refCoeffs; ++n) {
+            f += reference[n] * basis[n];
+        }
+        radiance[i] = Vector3((float)f);
+    }
+    const Vector3* coeffs = sh.ProjectRadiance(&radiance[0]);
+    double sum = 0.0;
+    for (int n=0; n<sh.GetNumCoeffs(); ++n) {
+        const double e = coeffs[n].GetX() - reference[n];
+        sum += e * e;
+    }
+    return sqrt(sum / sh.GetNumCoeffs());
+}
+
 /**
  * Projects a polar function and computes the SH Coeffs
- * @param fn the Polar Function. If the polar function is an image, pass a function that retrieves (R,G,B) values from it given a spherical coordinate.
+ * The function is evaluated once per sample into a radiance buffer, which is
+ * then projected with ProjectRadiance.
+ * @param fn the Polar Function. If the polar function is an image, pass a function that retrieves (R,G,B) values from it given a spherical coordinate. It must be safe to call it from several threads at once.
+ * @return the coefficients; NULL without a sample set
  */
 Vector3* SphericalHarmonics::ProjectPolarFn(polarFn fn)
 {
-    const double weight = 4.0*PI;
-    // for each sample
-    for(int i=0; i<m_numSamples; ++i) {
-        double theta = m_pSamples[i].sph.GetInclination();
-        double phi   = m_pSamples[i].sph.GetAzimuth();
-        for(int n=0; n<m_numCoeffs; ++n) {
-            m_pCoeffs[n] += fn(theta,phi) * m_pSamples[i].coeff[n];
+    if (!m_pSamples) return NULL;
+    std::vector<Vector3> radiance(m_numSamples);
+    const int numBlocks = (m_numSamples + SAMPLES_PER_BLOCK - 1) / SAMPLES_PER_BLOCK;
+    ParallelFor(numBlocks, m_numThreads, [&](int block) {
+        const int begin = block * SAMPLES_PER_BLOCK;
+        const int end = begin + SAMPLES_PER_BLOCK < m_numSamples ? begin + SAMPLES_PER_BLOCK : m_numSamples;
+        const float* theta = m_pSamples->GetTheta();
+        const float* phi = m_pSamples->GetPhi();
+        for(int i=begin; i<end; ++i) {
+            radiance[i] = fn(theta[i], phi[i]);
         }
-    }
+    });
+    return ProjectRadiance(&radiance[0]);
+}
+
+/**
+ * Projects a buffer of radiance values and computes the SH Coeffs
+ * This is the matrix product C = B * R, where B is the (numCoeffs x numSamples)
+ * basis matrix and R the (numSamples x 3) radiance matrix.
+ * The samples are split in blocks of SAMPLES_PER_BLOCK that are distributed among
+ * the worker threads (@see SetNumThreads). Every block keeps its own partial sums,
+ * and those are added up in block order, so the result is bit-identical for any
+ * number of threads.
+ * @param radiance RGB values, one per sample, in the same order as GetSamples()
+ * @return the coefficients; NULL without a sample set
+ */
+Vector3* SphericalHarmonics::ProjectRadiance(const Vector3* radiance)
+{
+    if (!m_pSamples) return NULL;
+    const double weight = 4.0*PI;
+    const int numBlocks = (m_numSamples + SAMPLES_PER_BLOCK - 1) / SAMPLES_PER_BLOCK;
+    std::vector<Vector3> partials(numBlocks * m_numCoeffs, Vector3::ZERO);
+    ParallelFor(numBlocks, m_numThreads, [&](int block) {
+        const int begin = block * SAMPLES_PER_BLOCK;
+        const int end = begin + SAMPLES_PER_BLOCK < m_numSamples ? begin + SAMPLES_PER_BLOCK : m_numSamples;
+        accumulateBlock(*m_pSamples, radiance, begin, end, &partials[block * m_numCoeffs]);
+    });
+    // reduce the partial sums in a fixed order
+    reducePartials(partials, numBlocks);
     // divide the result by weight and number of samples
     double factor = weight / m_numSamples;
     for(int i=0; i<m_numCoeffs; ++i) {
@@ -143,11 +419,523 @@ Vector3* SphericalHarmonics::ProjectPolarFn(polarFn fn)
     }
     
     // compute matrices for later
-    computeIrradianceApproximationMatrices();
+    computeIrradiance();
     
     return m_pCoeffs;
 }
 
+/**
+ * Projects a polar function progressively, a batch of SAMPLES_PER_BLOCK samples
+ * at a time, and stops as soon as the estimated relative error is below
+ * targetError or the time budget runs out.
+ * The batches are consecutive blocks of a scrambled Sobol set of GetNumSamples()
+ * samples (this object's set if it is already one, a shared one otherwise):
+ * every block of a power of 2 Sobol points is a net that covers the sphere
+ * evenly, so every batch is an unbiased estimate on its own. The running mean
+ * and variance of the batch estimates give the coefficients and their standard
+ * errors (Welford's algorithm, weighted by the batch sizes).
+ * Each round projects as many batches as worker threads, but the batches are
+ * added and checked in order, so without a time budget the result does not
+ * depend on the number of threads.
+ * @param targetError relative error, |standard errors| / |coefficients| over all the coefficients
+ * @param timeBudget in seconds; 0 means no limit
+ * @param coeffErrors if not NULL, receives the standard error of every coefficient
+ * @return the achieved error and the samples used; the coefficients are in GetCoeffs()
+ *  (without a sample set, nothing is projected and no samples are used)
+ */
+SphericalHarmonics::ProgressiveResult SphericalHarmonics::ProjectPolarFnProgressive(polarFn fn, double targetError,
+                                                                                     double timeBudget, Vector3* coeffErrors)
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    ProgressiveResult result;
+    result.relativeError = 1.0;
+    result.numSamples = 0;
+    result.numBatches = 0;
+    result.converged = false;
+    result.seconds = 0.0;
+    if (!m_pSamples) {
+        return result;
+    }
+    std::shared_ptr<const SHSampleSet> samples = m_pSamples;
+    if (m_generator != SAMPLE_GENERATOR_SOBOL) {
+        samples = SHSampleSet::Get(m_numBands, m_numSamples, SAMPLE_GENERATOR_SOBOL, m_seed, m_numThreads);
+    }
+    const int numBlocks = (m_numSamples + SAMPLES_PER_BLOCK - 1) / SAMPLES_PER_BLOCK;
+    const int blocksPerRound = ResolveNumThreads(m_numThreads);
+    std::vector<Vector3> radiance(m_numSamples);
+    std::vector<Vector3> partials((size_t)blocksPerRound * m_numCoeffs);
+    std::vector<double> mean((size_t)m_numCoeffs * 3, 0.0), m2((size_t)m_numCoeffs * 3, 0.0);
+    double totalWeight = 0.0;
+    int block = 0;
+    while (block < numBlocks) {
+        const int roundBlocks = std::min(blocksPerRound, numBlocks - block);
+        std::fill(partials.begin(), partials.end(), Vector3::ZERO);
+        ParallelFor(roundBlocks, m_numThreads, [&](int k) {
+            const int begin = (block + k) * SAMPLES_PER_BLOCK;
+            const int end = std::min(begin + SAMPLES_PER_BLOCK, m_numSamples);
+            const float* theta = samples->GetTheta();
+            const float* phi = samples->GetPhi();
+            for (int i=begin; i<end; ++i) {
+                radiance[i] = fn(theta[i], phi[i]);
+            }
+            accumulateBlock(*samples, &radiance[0], begin, end, &partials[(size_t)k * m_numCoeffs]);
+        });
+        for (int k = 0; k < roundBlocks && !result.converged; ++k) {
+            const int count = std::min(SAMPLES_PER_BLOCK, m_numSamples - block * SAMPLES_PER_BLOCK);
+            const double scale = 4.0 * PI_D / count;
+            totalWeight += count;
+            for (int n = 0; n < m_numCoeffs; ++n) {
+                for (int c = 0; c < 3; ++c) {
+                    const size_t index = (size_t)n * 3 + c;
+                    const double x = scale * partials[(size_t)k * m_numCoeffs + n](c);
+                    const double delta = x - mean[index];
+                    mean[index] += (count / totalWeight) * delta;
+                    m2[index] += count * delta * (x - mean[index]);
+                }
+            }
+            result.numSamples += count;
+            ++block;
+            // standard error of the mean of the batches; checked after every batch
+            // so the stopping point does not depend on the number of threads
+            if (block > 1) {
+                double errorSq = 0.0, normSq = 0.0;
+                for (size_t index = 0; index < mean.size(); ++index) {
+                    errorSq += m2[index] / totalWeight / (block - 1.0);
+                    normSq += mean[index] * mean[index];
+                }
+                result.relativeError = normSq > 0.0 ? sqrt(errorSq / normSq) : (errorSq > 0.0 ? 1.0 : 0.0);
+            }
+            result.converged = block >= MIN_PROGRESSIVE_BATCHES && result.relativeError <= targetError;
+        }
+        if (result.converged) {
+            break;
+        }
+        if (timeBudget > 0.0 && std::chrono::duration<double>(Clock::now() - start).count() >= timeBudget) {
+            break;
+        }
+    }
+    result.numBatches = block;
+    for (int n = 0; n < m_numCoeffs; ++n) {
+        m_pCoeffs[n] = Vector3((float)mean[n*3], (float)mean[n*3+1], (float)mean[n*3+2]);
+        if (coeffErrors != NULL) {
+            Vector3 error(0.f);
+            for (int c = 0; c < 3 && block > 1; ++c) {
+                error(c) = (float)sqrt(m2[n*3+c] / totalWeight / (block - 1.0));
+            }
+            coeffErrors[n] = error;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    computeIrradiance();
+    return result;
+}
+
+/**
+ * Projects several radiance buffers with the sample set of this object, as
+ * ProjectRadiance would do for each of them, with the same results. The basis
+ * rows are streamed once for every PROBES_PER_PASS probes instead of once per
+ * probe. Groups of probes are distributed among the worker threads.
+ * The coefficients of this object are not modified.
+ * @param radiance numProbes buffers of RGB values, one per sample
+ * @param coeffs numProbes * GetNumCoeffs() values; probe p starts at p * GetNumCoeffs(); not written without a sample set
+ */
+void SphericalHarmonics::ProjectRadianceBatch(int numProbes, const Vector3* const* radiance, Vector3* coeffs) const
+{
+    if (!m_pSamples) return;
+    const int numGroups = (numProbes + PROBES_PER_PASS - 1) / PROBES_PER_PASS;
+    const int numBlocks = (m_numSamples + SAMPLES_PER_BLOCK - 1) / SAMPLES_PER_BLOCK;
+    const float factor = (float)(4.0 * PI / m_numSamples);
+    ParallelFor(numGroups, m_numThreads, [&](int group) {
+        const int first = group * PROBES_PER_PASS;
+        const int count = std::min(PROBES_PER_PASS, numProbes - first);
+        std::vector<Vector3> partial((size_t)PROBES_PER_PASS * m_numCoeffs);
+        for (int p = 0; p < count; ++p) {
+            std::fill(coeffs + (size_t)(first + p) * m_numCoeffs, coeffs + (size_t)(first + p + 1) * m_numCoeffs, Vector3::ZERO);
+        }
+        // blocks in order, as reducePartials adds them
+        for (int block = 0; block < numBlocks; ++block) {
+            const int begin = block * SAMPLES_PER_BLOCK;
+            const int end = std::min(begin + SAMPLES_PER_BLOCK, m_numSamples);
+            std::fill(partial.begin(), partial.end(), Vector3::ZERO);
+            accumulateBlockProbes(radiance + first, count, begin, end, &partial[0]);
+            for (int p = 0; p < count; ++p) {
+                Vector3* out = coeffs + (size_t)(first + p) * m_numCoeffs;
+                for (int n = 0; n < m_numCoeffs; ++n) {
+                    out[n] += partial[(size_t)p * m_numCoeffs + n];
+                }
+            }
+        }
+        for (int p = 0; p < count; ++p) {
+            Vector3* out = coeffs + (size_t)(first + p) * m_numCoeffs;
+            for (int n = 0; n < m_numCoeffs; ++n) {
+                out[n] *= factor;
+            }
+        }
+    });
+}
+
+/**
+ * accumulateBlock for up to PROBES_PER_PASS probes; the missing probes are zero.
+ * @param sum PROBES_PER_PASS arrays of numCoeffs sums
+ */
+void SphericalHarmonics::accumulateBlockProbes(const Vector3* const* radiance, int numProbes, int begin, int end, Vector3* sum) const
+{
+    const int TILE_SAMPLES = 256;
+    float planar[PROBES_PER_PASS * 3 * TILE_SAMPLES];
+    Vector3* sums[PROBES_PER_PASS];
+    for (int p = 0; p < PROBES_PER_PASS; ++p) {
+        sums[p] = sum + (size_t)p * m_numCoeffs;
+    }
+    for (int s0 = begin; s0 < end; s0 += TILE_SAMPLES) {
+        const int count = s0 + TILE_SAMPLES < end ? TILE_SAMPLES : end - s0;
+        const int paddedCount = ((count + LANES - 1) / LANES) * LANES;
+        for (int p = 0; p < PROBES_PER_PASS; ++p) {
+            float* r = planar + 3 * p * TILE_SAMPLES;
+            float* g = r + TILE_SAMPLES;
+            float* b = g + TILE_SAMPLES;
+            int i = 0;
+            if (p < numProbes) {
+                for (; i < count; ++i) {
+                    r[i] = radiance[p][s0+i].GetX();
+                    g[i] = radiance[p][s0+i].GetY();
+                    b[i] = radiance[p][s0+i].GetZ();
+                }
+            }
+            for (; i < paddedCount; ++i) {
+                r[i] = g[i] = b[i] = 0.f;
+            }
+        }
+        const float* basis = m_pSamples->GetBasis(0) + s0;
+        const size_t stride = m_pSamples->GetStride();
+        switch (m_numBands) {
+            case 1: accumulateTileProbes<1, LANES, PROBES_PER_PASS>(basis, stride, m_numCoeffs, paddedCount, planar, TILE_SAMPLES, sums); break;
+            case 2: accumulateTileProbes<4, LANES, PROBES_PER_PASS>(basis, stride, m_numCoeffs, paddedCount, planar, TILE_SAMPLES, sums); break;
+            case 3: accumulateTileProbes<9, LANES, PROBES_PER_PASS>(basis, stride, m_numCoeffs, paddedCount, planar, TILE_SAMPLES, sums); break;
+            case 4: accumulateTileProbes<16, LANES, PROBES_PER_PASS>(basis, stride, m_numCoeffs, paddedCount, planar, TILE_SAMPLES, sums); break;
+            default: accumulateTileProbes<0, LANES, PROBES_PER_PASS>(basis, stride, m_numCoeffs, paddedCount, planar, TILE_SAMPLES, sums); break;
+        }
+    }
+}
+
+/**
+ * Cache-blocked kernel of the projection product for samples [begin, end).
+ * The radiance of a tile of samples is transposed to planar R, G, B arrays that
+ * stay in L1, and every basis row is then streamed linearly against them.
+ * Each row is summed into LANES independent accumulators so the inner loop
+ * vectorizes without reassociating floating-point additions.
+ */
+void SphericalHarmonics::accumulateBlock(const SHSampleSet& samples, const Vector3* radiance, int begin, int end, Vector3* sum) const
+{
+    const int TILE_SAMPLES = 256;
+    float r[TILE_SAMPLES], g[TILE_SAMPLES], b[TILE_SAMPLES];
+    for (int s0 = begin; s0 < end; s0 += TILE_SAMPLES) {
+        const int count = s0 + TILE_SAMPLES < end ? TILE_SAMPLES : end - s0;
+        const int paddedCount = ((count + LANES - 1) / LANES) * LANES;
+        for (int i = 0; i < count; ++i) {
+            r[i] = radiance[s0+i].GetX();
+            g[i] = radiance[s0+i].GetY();
+            b[i] = radiance[s0+i].GetZ();
+        }
+        for (int i = count; i < paddedCount; ++i) {
+            r[i] = g[i] = b[i] = 0.f;
+        }
+        accumulateRows(samples.GetBasis(0) + s0, samples.GetStride(), paddedCount, r, g, b, sum);
+    }
+}
+
+/**
+ * Adds the dot product of paddedCount values of every basis row with the planar radiance.
+ * Dispatches to a kernel unrolled for the number of coefficients when possible.
+ */
+void SphericalHarmonics::accumulateRows(const float* basis, size_t basisStride, int paddedCount,
+                                        const float* r, const float* g, const float* b, Vector3* sum) const
+{
+    switch (m_numBands) {
+        case 1: accumulateTile<1, LANES>(basis, basisStride, m_numCoeffs, paddedCount, r, g, b, sum); break;
+        case 2: accumulateTile<4, LANES>(basis, basisStride, m_numCoeffs, paddedCount, r, g, b, sum); break;
+        case 3: accumulateTile<9, LANES>(basis, basisStride, m_numCoeffs, paddedCount, r, g, b, sum); break;
+        case 4: accumulateTile<16, LANES>(basis, basisStride, m_numCoeffs, paddedCount, r, g, b, sum); break;
+        default: accumulateTile<0, LANES>(basis, basisStride, m_numCoeffs, paddedCount, r, g, b, sum); break;
+    }
+}
+
+/// Floats per row of the scratch of accumulateTexelRow: the width rounded up to a multiple of LANES
+int SphericalHarmonics::texelStride(int width)
+{
+    return ((width + LANES - 1) / LANES) * LANES;
+}
+
+/**
+ * Adds the contribution of width texels of a row, starting at column begin,
+ * sum[n] += Σ weight_i * pixel_i * Y_n(dir_i).
+ * The directions, weights and basis of the row are computed on the fly.
+ * @param stride width rounded up to a multiple of LANES (@see texelStride)
+ * @param scratch (numCoeffs + 7) * stride floats, zeroed before its first use
+ */
+void SphericalHarmonics::accumulateTexelRow(const TexelTable& table, int row, int begin,
+                                            const float* pixels, int pixelStride, int width, int stride,
+                                            float* scratch, Vector3* sum) const
+{
+    float* basis = scratch;
+    float* r = basis + (size_t)m_numCoeffs * stride;
+    float* g = r + stride;
+    float* b = g + stride;
+    float* x = b + stride;
+    float* y = x + stride;
+    float* z = y + stride;
+    float* weight = z + stride;
+    table.ComputeRow(row, begin, width, x, y, z, weight);
+    SHBasisBatch(m_numBands, width, x, y, z, basis, stride);
+    for (int i = 0; i < width; ++i) {
+        const float* p = pixels + (size_t)i * pixelStride;
+        r[i] = weight[i] * p[0];
+        g[i] = weight[i] * p[1];
+        b[i] = weight[i] * p[2];
+    }
+    // the padding of the scratch is never written, so it stays zero
+    const int paddedCount = ((width + LANES - 1) / LANES) * LANES;
+    accumulateRows(basis, stride, paddedCount, r, g, b, sum);
+}
+
+/**
+ * Integrates a light probe made of two hemispheres exactly: every texel of both
+ * images is visited once, weighted by its solid angle (@see TexelTable).
+ * This is the mapping polarSampler assumes, i.e. both images side by side form
+ * an equirectangular map, so an equirectangular map can be passed as its left
+ * and right halves (@see RadianceImage::GetRegion).
+ * The result is deterministic and costs width * height * numCoeffs MACs per image.
+ * Rows are distributed among the worker threads and their partial sums are
+ * added in row order, so the result does not depend on the number of threads.
+ * @param front front hemisphere, azimuth in [0,π)
+ * @param back back hemisphere, azimuth in [π,2π)
+ */
+Vector3* SphericalHarmonics::ProjectDualHemisphere(const RadianceImage& front, const RadianceImage& back)
+{
+    const RadianceImage images[2] = { front, back };
+    const TexelTable::Mapping mappings[2] = { TexelTable::MAPPING_HEMISPHERE_FRONT, TexelTable::MAPPING_HEMISPHERE_BACK };
+    return projectTexels(2, images, mappings);
+}
+
+/**
+ * Integrates an equirectangular map exactly: inclination from 0 (top row) to π,
+ * and azimuth from 0 (left column) to 2π. It is the same as two hemispheres
+ * side by side, so its width must be even.
+ * @see ProjectDualHemisphere
+ * @return the coefficients; NULL if the width is odd
+ */
+Vector3* SphericalHarmonics::ProjectEquirect(const RadianceImage& image)
+{
+    if (image.width % 2 != 0) {
+        return NULL;
+    }
+    const int halfWidth = image.width / 2;
+    return ProjectDualHemisphere(image.GetRegion(0, 0, halfWidth, image.height),
+                                 image.GetRegion(halfWidth, 0, halfWidth, image.height));
+}
+
+/**
+ * Integrates a cube map exactly: every texel of the 6 faces is visited once,
+ * weighted by its solid angle (@see TexelTable). The directions of the faces are
+ * in the same space as Spherical::ToVector3 (y is up).
+ * Faces are independent, so rows of all the faces run in parallel, and their
+ * direction and weight tables are computed once per face size.
+ * @param faces +X, -X, +Y, -Y, +Z, -Z (@see TexelTable::Mapping)
+ */
+Vector3* SphericalHarmonics::ProjectCubeMap(const RadianceImage faces[6])
+{
+    const TexelTable::Mapping mappings[6] = {
+        TexelTable::MAPPING_CUBE_POSITIVE_X, TexelTable::MAPPING_CUBE_NEGATIVE_X,
+        TexelTable::MAPPING_CUBE_POSITIVE_Y, TexelTable::MAPPING_CUBE_NEGATIVE_Y,
+        TexelTable::MAPPING_CUBE_POSITIVE_Z, TexelTable::MAPPING_CUBE_NEGATIVE_Z
+    };
+    return projectTexels(6, faces, mappings);
+}
+
+/**
+ * Updates the coefficients of a texel projection (ProjectDualHemisphere,
+ * ProjectEquirect, ProjectCubeMap) after a rectangle of one of its images
+ * changed. Projection is linear, so only the difference of the texels of the
+ * rectangle is projected and added; the cost is proportional to its area.
+ * The result matches a full projection of the new image up to rounding.
+ * @param mapping mapping of the image (@see TexelTable)
+ * @param width,height size of the whole image
+ * @param x,y top-left texel of the rectangle in the image
+ * @param oldRegion,newRegion contents of the rectangle before and after the change
+ */
+Vector3* SphericalHarmonics::UpdateTexelRegion(TexelTable::Mapping mapping, int width, int height, int x, int y,
+                                               const RadianceImage& oldRegion, const RadianceImage& newRegion)
+{
+    const int w = oldRegion.width;
+    const int h = oldRegion.height;
+    if (!oldRegion.IsValid() || newRegion.width != w || newRegion.height != h
+        || x < 0 || y < 0 || x + w > width || y + h > height) {
+        return m_pCoeffs;
+    }
+    std::shared_ptr<const TexelTable> table = TexelTable::Get(mapping, width, height);
+    const int stride = texelStride(w);
+    const int numTasks = (h + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    std::vector<Vector3> partials((size_t)h * m_numCoeffs, Vector3::ZERO);
+    ParallelFor(numTasks, m_numThreads, [&](int task) {
+        std::vector<float> scratch((size_t)(m_numCoeffs + 7) * stride, 0.f);
+        std::vector<float> delta((size_t)w * 3);
+        const int end = std::min(h, (task + 1) * ROWS_PER_TASK);
+        for (int row = task * ROWS_PER_TASK; row < end; ++row) {
+            for (int i = 0; i < w; ++i) {
+                const float* before = oldRegion.GetPixel(i, row);
+                const float* after = newRegion.GetPixel(i, row);
+                delta[3*i] = after[0] - before[0];
+                delta[3*i+1] = after[1] - before[1];
+                delta[3*i+2] = after[2] - before[2];
+            }
+            const int j = y + row;
+            accumulateTexelRow(*table, j, x, &delta[0], 3, w, stride, &scratch[0], &partials[(size_t)row * m_numCoeffs]);
+        }
+    });
+    std::vector<Vector3> regionSum(m_numCoeffs, Vector3::ZERO);
+    for (int row = 0; row < h; ++row) {
+        const Vector3* sum = &partials[(size_t)row * m_numCoeffs];
+        for (int n=0; n<m_numCoeffs; ++n) {
+            regionSum[n] += sum[n];
+        }
+    }
+    for (int n=0; n<m_numCoeffs; ++n) {
+        m_pCoeffs[n] += regionSum[n];
+    }
+    computeIrradiance();
+    return m_pCoeffs;
+}
+
+/**
+ * UpdateTexelRegion for a rectangle of an equirectangular map projected with
+ * ProjectEquirect; the rectangle may cross the middle of the map.
+ * @return the coefficients; NULL if the width is odd
+ */
+Vector3* SphericalHarmonics::UpdateEquirectRegion(int width, int height, int x, int y,
+                                                  const RadianceImage& oldRegion, const RadianceImage& newRegion)
+{
+    if (width % 2 != 0) {
+        return NULL;
+    }
+    const int halfWidth = width / 2;
+    const int w = oldRegion.width;
+    const int h = oldRegion.height;
+    const int frontWidth = std::max(0, std::min(halfWidth - x, w));
+    if (frontWidth > 0) {
+        UpdateTexelRegion(TexelTable::MAPPING_HEMISPHERE_FRONT, halfWidth, height, x, y,
+                          oldRegion.GetRegion(0, 0, frontWidth, h), newRegion.GetRegion(0, 0, frontWidth, h));
+    }
+    if (frontWidth < w) {
+        UpdateTexelRegion(TexelTable::MAPPING_HEMISPHERE_BACK, halfWidth, height, x + frontWidth - halfWidth, y,
+                          oldRegion.GetRegion(frontWidth, 0, w - frontWidth, h), newRegion.GetRegion(frontWidth, 0, w - frontWidth, h));
+    }
+    return m_pCoeffs;
+}
+
+/**
+ * Integrates every texel of a set of images that together cover the sphere.
+ * Rows are distributed among the worker threads and their partial sums are
+ * added in row order, so the result does not depend on the number of threads.
+ */
+Vector3* SphericalHarmonics::projectTexels(int numImages, const RadianceImage* images, const TexelTable::Mapping* mappings)
+{
+    std::vector<std::shared_ptr<const TexelTable> > tables(numImages);
+    std::vector<int> firstRow(numImages + 1, 0);
+    for (int k=0; k<numImages; ++k) {
+        tables[k] = TexelTable::Get(mappings[k], images[k].width, images[k].height);
+        firstRow[k+1] = firstRow[k] + images[k].height;
+    }
+    const int numRows = firstRow[numImages];
+    const int numTasks = (numRows + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    std::vector<Vector3> partials((size_t)numRows * m_numCoeffs, Vector3::ZERO);
+    ParallelFor(numTasks, m_numThreads, [&](int task) {
+        std::vector<float> scratch;
+        const int end = (task + 1) * ROWS_PER_TASK < numRows ? (task + 1) * ROWS_PER_TASK : numRows;
+        int k = 0;
+        for (int row = task * ROWS_PER_TASK; row < end; ++row) {
+            while (row >= firstRow[k+1]) ++k;
+            const int j = row - firstRow[k];
+            const int stride = texelStride(images[k].width);
+            const size_t scratchSize = (size_t)(m_numCoeffs + 7) * stride;
+            if (scratch.size() != scratchSize) {
+                scratch.assign(scratchSize, 0.f);
+            }
+            accumulateTexelRow(*tables[k], j, 0, images[k].GetRow(j), images[k].pixelStride, images[k].width, stride,
+                               &scratch[0], &partials[(size_t)row * m_numCoeffs]);
+        }
+    });
+    // every image is reduced in row order on its own, and then the images are added in order
+    std::vector<Vector3> imageSum(m_numCoeffs);
+    for (int i=0; i<m_numCoeffs; ++i) {
+        m_pCoeffs[i] = Vector3::ZERO;
+    }
+    for (int k=0; k<numImages; ++k) {
+        std::fill(imageSum.begin(), imageSum.end(), Vector3::ZERO);
+        for (int row = firstRow[k]; row < firstRow[k+1]; ++row) {
+            const Vector3* sum = &partials[(size_t)row * m_numCoeffs];
+            for (int n=0; n<m_numCoeffs; ++n) {
+                imageSum[n] += sum[n];
+            }
+        }
+        for (int n=0; n<m_numCoeffs; ++n) {
+            m_pCoeffs[n] += imageSum[n];
+        }
+    }
+    computeIrradiance();
+    return m_pCoeffs;
+}
+
+/// Adds numPartials partial sums of numCoeffs coefficients to the coefficients, in order
+void SphericalHarmonics::reducePartials(const std::vector<Vector3>& partials, int numPartials)
+{
+    // every projection starts from zero
+    for (int n=0; n<m_numCoeffs; ++n) {
+        m_pCoeffs[n] = Vector3::ZERO;
+    }
+    for (int p=0; p<numPartials; ++p) {
+        const Vector3* sum = &partials[(size_t)p * m_numCoeffs];
+        for (int n=0; n<m_numCoeffs; ++n) {
+            m_pCoeffs[n] += sum[n];
+        }
+    }
+}
+
+/**
+ * Zonal harmonic coefficients of the clamped cosine, so that the irradiance
+ * coefficients are E_lm = ClampedCosineZonal(l) * L_lm. They are π, 2π/3,
+ * and zero for the other odd bands; for even l,
+ *  2π (-1)^(l/2-1) / ((l+2)(l-1)) * l! / (2^l (l/2)!^2)
+ * @see "On the relationship between radiance and irradiance", Ramamoorthi & Hanrahan
+ */
+double SphericalHarmonics::ClampedCosineZonal(int l)
+{
+    if (l == 0) return PI_D;
+    if (l == 1) return 2.0 * PI_D / 3.0;
+    if (l % 2 == 1) return 0.0;
+    // binomial(l, l/2) / 2^l, as a product to avoid overflows
+    double central = 1.0;
+    for (int k = 1; k <= l/2; ++k) {
+        central *= (double)(l/2 + k) / (4.0 * k);
+    }
+    const double sign = (l/2) % 2 == 1 ? 1.0 : -1.0;
+    return 2.0 * PI_D * sign * central / ((l + 2.0) * (l - 1.0));
+}
+
+/**
+ * Convolves the coefficients with the clamped cosine. The matrices of the
+ * 3-band approximation are kept for GetIrradianceApproximation.
+ */
+void SphericalHarmonics::computeIrradiance()
+{
+    for (int l = 0; l < m_numBands; ++l) {
+        const float a = (float)ClampedCosineZonal(l);
+        for (int n = l*l; n < (l+1)*(l+1); ++n) {
+            m_pIrradianceCoeffs[n] = m_pCoeffs[n] * a;
+        }
+    }
+    computeIrradianceApproximationMatrices();
+}
+
 /**
  * @see "An efficient representation for Irradiance Environment Maps"
  */
@@ -186,15 +974,36 @@ void SphericalHarmonics::computeIrradianceApproximationMatrices()
         m_mIrradiance[i](3,2) = k1 * m_pCoeffs[2](i);
         m_mIrradiance[i](3,3) = k2 * m_pCoeffs[0](i) - k3 * m_pCoeffs[6](i);
     }
+    
+    // the same quadratic forms, expanded in our frame: (-z, -x, y, 1) M (-z, -x, y, 1)^T
+    for (int i = 0; i<3; ++i) {
+        const Matrix4& m = m_mIrradiance[i];
+        float* c = m_irradianceForm[i];
+        c[0] = m(1,1);          // xx
+        c[1] = -2.f * m(1,2);   // xy
+        c[2] = 2.f * m(0,1);    // xz
+        c[3] = -2.f * m(1,3);   // x
+        c[4] = m(2,2);          // yy
+        c[5] = -2.f * m(0,2);   // yz
+        c[6] = 2.f * m(2,3);    // y
+        c[7] = m(0,0);          // zz
+        c[8] = -2.f * m(0,3);   // z
+        c[9] = m(3,3);          // 1
+    }
 }
 
 /**
- * Computes the approximate irradiance for the given normal direction
+ * Computes the approximate irradiance for the given normal direction.
+ * The matrices use the frame of the paper, (x,y,z) = (sinθ cosφ, sinθ sinφ, cosθ),
+ * with the Condon-Shortley phase of our basis folded into the signs of x and y.
  */
-Vector3 SphericalHarmonics::GetIrradianceApproximation(const vd::math::Vector3 &normal)
+Vector3 SphericalHarmonics::GetIrradianceApproximation(const vd::math::Vector3 &normal) const
 {
+    if (m_irradianceBands != 3) {
+        return evaluate(m_pIrradianceCoeffs, m_irradianceBands, normal);
+    }
     Vector3 v(0);
-    Vector4 n(normal,1);
+    Vector4 n(-normal.GetZ(), -normal.GetX(), normal.GetY(), 1);
     // for every color channel
     for (int i = 0; i<3; ++i) {
         v(i) = Dot(n, m_mIrradiance[i] * n);
@@ -202,5 +1011,89 @@ Vector3 SphericalHarmonics::GetIrradianceApproximation(const vd::math::Vector3 &
     return v;
 }
 
-MATH_NS_END
+/**
+ * Computes the approximate irradiance of count normals at once, several at a time with SIMD.
+ * Equivalent to GetIrradianceApproximation for every normal, up to rounding.
+ * @param x,y,z structure-of-arrays normals, as in Spherical::ToVector3
+ * @param r,g,b irradiance of every normal
+ */
+void SphericalHarmonics::GetIrradianceApproximation(int count, const float* x, const float* y, const float* z,
+                                                    float* r, float* g, float* b) const
+{
+    if (m_irradianceBands != 3) {
+        evaluateBatch(m_pIrradianceCoeffs, m_irradianceBands, count, x, y, z, r, g, b);
+        return;
+    }
+    int i = 0;
+    for (; i + SimdFloat::WIDTH <= count; i += SimdFloat::WIDTH) {
+        evalIrradiance<SimdFloat>(m_irradianceForm, x+i, y+i, z+i, r+i, g+i, b+i);
+    }
+    // remainder
+    for (; i < count; ++i) {
+        evalIrradiance<float>(m_irradianceForm, x+i, y+i, z+i, r+i, g+i, b+i);
+    }
+}
+
+/**
+ * Evaluates the SH expansion of the current coefficients in the given direction
+ * @param direction unit vector, as in Spherical::ToVector3
+ */
+Vector3 SphericalHarmonics::Reconstruct(const Vector3& direction) const
+{
+    return evaluate(m_pCoeffs, m_numBands, direction);
+}
 
+/// Sum of coeffs[n] * Y_n(direction) for the first numBands bands
+Vector3 SphericalHarmonics::evaluate(const Vector3* coeffs, int numBands, const Vector3& direction)
+{
+    switch (numBands) {
+        case 1: return reconstruct<1>(coeffs, direction);
+        case 2: return reconstruct<2>(coeffs, direction);
+        case 3: return reconstruct<3>(coeffs, direction);
+        case 4: return reconstruct<4>(coeffs, direction);
+        default: break;
+    }
+    // theta & phi of the direction (@see Spherical::ToVector3)
+    const double theta = acos(Clamp(direction.GetY(), -1.f, 1.f));
+    double phi = atan2(direction.GetX(), direction.GetZ());
+    if (phi < 0.0) phi += 2.0 * PI;
+    const int numCoeffs = numBands * numBands;
+    std::vector<double> basis(numCoeffs);
+    SHAll(numBands, theta, phi, &basis[0]);
+    Vector3 v(0.f);
+    for (int n = 0; n < numCoeffs; ++n) {
+        v += coeffs[n] * (float)basis[n];
+    }
+    return v;
+}
+
+/// evaluate for count directions, with the basis of EVAL_CHUNK directions at a time
+void SphericalHarmonics::evaluateBatch(const Vector3* coeffs, int numBands, int count,
+                                       const float* x, const float* y, const float* z,
+                                       float* r, float* g, float* b)
+{
+    const int numCoeffs = numBands * numBands;
+    float stackBasis[EVAL_STACK_COEFFS * EVAL_CHUNK];
+    std::vector<float> heapBasis(numCoeffs > EVAL_STACK_COEFFS ? numCoeffs * EVAL_CHUNK : 0);
+    float* basis = numCoeffs > EVAL_STACK_COEFFS ? &heapBasis[0] : stackBasis;
+    for (int begin = 0; begin < count; begin += EVAL_CHUNK) {
+        const int n = std::min(EVAL_CHUNK, count - begin);
+        SHBasisBatch(numBands, n, x + begin, y + begin, z + begin, basis, EVAL_CHUNK);
+        for (int i = 0; i < n; ++i) {
+            r[begin+i] = coeffs[0].GetX() * basis[i];
+            g[begin+i] = coeffs[0].GetY() * basis[i];
+            b[begin+i] = coeffs[0].GetZ() * basis[i];
+        }
+        for (int k = 1; k < numCoeffs; ++k) {
+            const float cr = coeffs[k].GetX(), cg = coeffs[k].GetY(), cb = coeffs[k].GetZ();
+            const float* row = basis + k * EVAL_CHUNK;
+            for (int i = 0; i < n; ++i) {
+                r[begin+i] += cr * row[i];
+                g[begin+i] += cg * row[i];
+                b[begin+i] += cb * row[i];
+            }
+        }
+    }
+}
+
+MATH_NS_END
@@ -10,30 +10,55 @@
 #ifndef MATH_SPHERICAL_HARMONICS_H_
 #define MATH_SPHERICAL_HARMONICS_H_
 
+#include <vector>
 #include "math/Common.h"
 #include "math/Vector.h"
 #include "math/Matrix.h"
 #include "math/Spherical.h"
+#include "math/SHSampleSet.h"
+#include "math/SampleGenerator.h"
+#include "math/RadianceImage.h"
+#include "math/TexelTable.h"
 
 MATH_NS_BEGIN
 
-/** SphericalHarmonics Samples */
-struct SHSample {
-    Spherical sph;
-    Vector3 vec;
-    double *coeff;
-};
-
 /**
  *  This class computes the Spherical Harmonics of an image
  */
 class SphericalHarmonics {
 public:
+    /// Samples accumulated by a single task; fixed so results are independent of the thread count
+    static const int SAMPLES_PER_BLOCK = 4096;
+    /// Image rows integrated by a single task
+    static const int ROWS_PER_TASK = 4;
+    /// Probes accumulated together by ProjectRadianceBatch
+    static const int PROBES_PER_PASS = 4;
+    
+    /// Coefficients of the quadratic form of the irradiance of a channel: xx, xy, xz, x, yy, yz, y, zz, z, 1
+    static const int IRRADIANCE_FORM_SIZE = 10;
+    
+    /// Batches a progressive projection uses before it can stop
+    static const int MIN_PROGRESSIVE_BATCHES = 4;
+    
+    /// Outcome of ProjectPolarFnProgressive
+    struct ProgressiveResult {
+        double  relativeError;  ///< estimated error of the coefficients, relative to their magnitude
+        int     numSamples;     ///< samples used
+        int     numBatches;     ///< batches used
+        bool    converged;      ///< whether the target error was reached
+        double  seconds;        ///< time spent
+    };
+    
     /// Polar function
     typedef Vector3 (*polarFn)(double theta, double phi);
     
+    /// Tag of the constructor of objects that only project texels, and need no sample set
+    enum TexelsOnly { TEXELS_ONLY };
+    
 public:
     SphericalHarmonics(int numBands = 3, int numSamplesSqr = 100);
+    SphericalHarmonics(int numBands, SampleGenerator generator, int numSamples, uint32_t seed = 0);
+    SphericalHarmonics(int numBands, TexelsOnly);
     ~SphericalHarmonics();
     
     // -----------------------------------------------------------
@@ -42,29 +67,100 @@ public:
     inline int GetNumBands() const { return m_numBands; }
     inline int GetNumCoeffs() const { return m_numCoeffs; }
     inline const Vector3* GetCoeffs() const { return m_pCoeffs; }
+    inline int GetNumSamples() const { return m_numSamples; }
+    /// Whether there is a sample set; not with TEXELS_ONLY
+    inline bool HasSamples() const { return m_pSamples != NULL; }
+    /// The sample set (@see HasSamples)
+    inline const SHSampleSet& GetSamples() const { return *m_pSamples; }
+    inline SampleGenerator GetSampleGenerator() const { return m_generator; }
+    inline uint32_t GetSeed() const { return m_seed; }
+    inline int GetNumThreads() const { return m_numThreads; }
+    /// Coefficients convolved with the clamped cosine: the SH projection of the irradiance
+    inline const Vector3* GetIrradianceCoeffs() const { return m_pIrradianceCoeffs; }
+    inline int GetIrradianceBands() const { return m_irradianceBands; }
     
-    // projects a polar function and computes the SH Coeffs
+    // -----------------------------------------------------------
+    // setters
+    // -----------------------------------------------------------
+    /// Number of worker threads used for projection (0 = all hardware threads)
+    inline void SetNumThreads(int numThreads) { m_numThreads = numThreads; }
+    /// Bands used to evaluate the irradiance, in [1, GetNumBands()] (all by default); fewer is faster
+    void SetIrradianceBands(int numBands);
+    
+    // projects a polar function and computes the SH Coeffs (this and the other sample projections need HasSamples)
     Vector3* ProjectPolarFn(polarFn fn);
-    // given a normal vector, retrieves the irradiance value
-    Vector3 GetIrradianceApproximation(const Vector3& normal);
+    // projects a polar function in batches until the estimated error is small enough
+    ProgressiveResult ProjectPolarFnProgressive(polarFn fn, double targetError, double timeBudget = 0.0,
+                                                Vector3* coeffErrors = NULL);
+    // projects precomputed radiance values, one per sample (@see GetSamples)
+    Vector3* ProjectRadiance(const Vector3* radiance);
+    // projects the radiance of several probes at once, into separate coefficients
+    void ProjectRadianceBatch(int numProbes, const Vector3* const* radiance, Vector3* coeffs) const;
+    // integrates every texel of a light probe made of 2 hemispheres
+    Vector3* ProjectDualHemisphere(const RadianceImage& front, const RadianceImage& back);
+    // integrates every texel of an equirectangular (latitude-longitude) map, of even width
+    Vector3* ProjectEquirect(const RadianceImage& image);
+    // integrates every texel of a cube map
+    Vector3* ProjectCubeMap(const RadianceImage faces[6]);
+    // updates a texel projection after a rectangle of one of its images changed
+    Vector3* UpdateTexelRegion(TexelTable::Mapping mapping, int width, int height, int x, int y,
+                               const RadianceImage& oldRegion, const RadianceImage& newRegion);
+    // updates ProjectEquirect after a rectangle of the map changed
+    Vector3* UpdateEquirectRegion(int width, int height, int x, int y,
+                                  const RadianceImage& oldRegion, const RadianceImage& newRegion);
+    // given a normal vector (as in Spherical::ToVector3), retrieves the irradiance value
+    Vector3 GetIrradianceApproximation(const Vector3& normal) const;
+    // irradiance of arrays of normals, in structure-of-arrays form
+    void GetIrradianceApproximation(int count, const float* x, const float* y, const float* z,
+                                    float* r, float* g, float* b) const;
+    // evaluates the projected function in the given direction
+    Vector3 Reconstruct(const Vector3& direction) const;
     
     // Associated Legendre Polynomial
     static double P(int l,int m,double x);
     // renormalization constant for SH function
     static double K(int l, int m);
     static double SH(int l, int m, double theta, double phi);
+    // all the SH basis functions of numBands bands at once
+    static void SHAll(int numBands, double theta, double phi, double* result);
+    // RMS error of the projection of a known band-limited function with a sample set
+    static double MeasureSamplingError(int numBands, SampleGenerator generator, int numSamples, uint32_t seed = 0);
+    // band l of the SH projection of the clamped cosine, max(cos θ, 0), times sqrt(4π/(2l+1))
+    static double ClampedCosineZonal(int l);
     
 private:
-    void setupSphericalSamples(SHSample samples[], int sqrt_n_samples);
+    void computeIrradiance();
     void computeIrradianceApproximationMatrices();
+    static Vector3 evaluate(const Vector3* coeffs, int numBands, const Vector3& direction);
+    static void evaluateBatch(const Vector3* coeffs, int numBands, int count,
+                              const float* x, const float* y, const float* z,
+                              float* r, float* g, float* b);
+    void accumulateBlock(const SHSampleSet& samples, const Vector3* radiance, int begin, int end, Vector3* sum) const;
+    void accumulateBlockProbes(const Vector3* const* radiance, int numProbes, int begin, int end, Vector3* sum) const;
+    void accumulateRows(const float* basis, size_t basisStride, int paddedCount,
+                        const float* r, const float* g, const float* b, Vector3* sum) const;
+    void accumulateTexelRow(const TexelTable& table, int row, int begin,
+                            const float* pixels, int pixelStride, int width, int stride,
+                            float* scratch, Vector3* sum) const;
+    static int texelStride(int width);
+    Vector3* projectTexels(int numImages, const RadianceImage* images, const TexelTable::Mapping* mappings);
+    void reducePartials(const std::vector<Vector3>& partials, int numPartials);
+    
+    friend class SHStreamProjector;
     
 private:
-    SHSample*   m_pSamples;         ///< SHSamples
+    std::shared_ptr<const SHSampleSet> m_pSamples; ///< Sample directions and basis values (shared)
     int         m_numBands;         ///< Number of bands
     int         m_numCoeffs;        ///< Number of coeffs
     int         m_numSamples;       ///< Number of samples
+    int         m_numThreads;       ///< Worker threads (0 = hardware threads)
+    SampleGenerator m_generator;    ///< How the sample directions are placed
+    uint32_t    m_seed;             ///< Randomization of the sample directions
     Vector3*    m_pCoeffs;          ///< SH Coefficients (result)
+    Vector3*    m_pIrradianceCoeffs; ///< SH Coefficients of the irradiance
+    int         m_irradianceBands;  ///< Bands used to evaluate the irradiance
     Matrix4     m_mIrradiance[3];   ///< Matrices used to approximate irradiance
+    float       m_irradianceForm[3][IRRADIANCE_FORM_SIZE]; ///< m_mIrradiance expanded for the batch evaluation
     
 }; // SphericalHarmonics
 
@@ -0,0 +1,253 @@
+//
+//  TexelTable.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <mutex>
+#include <stdint.h>
+#include "math/TexelTable.h"
+
+MATH_NS_BEGIN
+
+namespace {
+    const double PI_D = 3.14159265358979323846;
+    /// bytes of unused tables the cache keeps
+    const size_t MAX_CACHE_SIZE = 64 << 20;
+    
+    struct TableKey {
+        int mapping;
+        int width;
+        int height;
+        bool operator<(const TableKey& rhs) const {
+            if (mapping != rhs.mapping) return mapping < rhs.mapping;
+            if (width != rhs.width) return width < rhs.width;
+            return height < rhs.height;
+        }
+    };
+    
+    struct CacheEntry {
+        std::shared_ptr<const TexelTable> table;
+        uint64_t lastUse;   ///< value of g_cacheClock when it was last requested
+    };
+    
+    /// Solid angle subtended by the rectangle (0,0)-(x,y) of the plane z=1
+    inline double areaElement(double x, double y) {
+        return atan2(x * y, sqrt(x * x + y * y + 1.0));
+    }
+    
+    /// Direction of the point (u,v) in [-1,1]^2 of a cube face (not normalized)
+    Vector3 cubeDirection(TexelTable::Mapping face, float u, float v) {
+        switch (face) {
+            case TexelTable::MAPPING_CUBE_POSITIVE_X: return Vector3(1.f, -v, -u);
+            case TexelTable::MAPPING_CUBE_NEGATIVE_X: return Vector3(-1.f, -v, u);
+            case TexelTable::MAPPING_CUBE_POSITIVE_Y: return Vector3(u, 1.f, v);
+            case TexelTable::MAPPING_CUBE_NEGATIVE_Y: return Vector3(u, -1.f, -v);
+            case TexelTable::MAPPING_CUBE_POSITIVE_Z: return Vector3(u, -v, 1.f);
+            default: return Vector3(-u, -v, -1.f);
+        }
+    }
+    
+    /// Copies columns [begin, begin+count) of a row symmetric about its center, given its first (width+1)/2 values
+    void mirrorRow(const float* half, int width, int begin, int count, float* out) {
+        const int halfWidth = (width + 1) / 2;
+        const int end = begin + count;
+        const int split = std::max(begin, std::min(end, halfWidth));
+        for (int i=begin; i<split; ++i) {
+            out[i - begin] = half[i];
+        }
+        for (int i=split; i<end; ++i) {
+            out[i - begin] = half[width - 1 - i];
+        }
+    }
+    
+    std::mutex g_cacheMutex;
+    std::map<TableKey, CacheEntry> g_cache;
+    uint64_t g_cacheClock = 0;
+    
+    /// Drops the least recently used tables that are not in use until the rest fit in the budget
+    void trimCache() {
+        size_t size = 0;
+        for (auto it = g_cache.begin(); it != g_cache.end(); ++it) {
+            if (it->second.table.use_count() == 1) {
+                size += it->second.table->GetSize();
+            }
+        }
+        while (size > MAX_CACHE_SIZE) {
+            auto oldest = g_cache.end();
+            for (auto it = g_cache.begin(); it != g_cache.end(); ++it) {
+                if (it->second.table.use_count() == 1
+                    && (oldest == g_cache.end() || it->second.lastUse < oldest->second.lastUse)) {
+                    oldest = it;
+                }
+            }
+            size -= oldest->second.table->GetSize();
+            g_cache.erase(oldest);
+        }
+    }
+}
+
+std::shared_ptr<const TexelTable> TexelTable::Get(Mapping mapping, int width, int height)
+{
+    TableKey key = { mapping, width, height };
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    CacheEntry& entry = g_cache[key];
+    entry.lastUse = ++g_cacheClock;
+    if (!entry.table) {
+        try {
+            entry.table = std::make_shared<TexelTable>(mapping, width, height);
+        } catch (...) {
+            g_cache.erase(key);
+            throw;
+        }
+        std::shared_ptr<const TexelTable> table = entry.table;
+        trimCache();
+        return table;
+    }
+    return entry.table;
+}
+
+void TexelTable::ClearCache()
+{
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    for (auto it = g_cache.begin(); it != g_cache.end(); ) {
+        if (it->second.table.use_count() == 1) {
+            it = g_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+Vector3 TexelTable::GetCubeDirection(Mapping face, float u, float v)
+{
+    const Vector3 d = cubeDirection(face, u, v);
+    return (1.0f / Length(d)) * d;
+}
+
+/**
+ * The hemisphere mappings are the ones polarSampler assumes: the texel (i,j)
+ * covers the inclination [π j/H, π (j+1)/H] and the azimuth [π i/W, π (i+1)/W]
+ * (plus π for the back). Its solid angle is exactly Δφ (cos θ0 - cos θ1).
+ * The solid angle of a cube texel comes from the area element of its 4 corners,
+ * @see "Cubemap Texel Solid Angle", Manne Ohrstrom. It and the length of (u,v,1)
+ * only depend on |u| and |v|, so only the quadrant u,v < 0 is kept.
+ */
+TexelTable::TexelTable(Mapping mapping, int width, int height)
+: m_mapping(mapping)
+, m_width(width)
+, m_height(height)
+{
+    if (IsCube()) {
+        const double invW = 2.0 / width;
+        const double invH = 2.0 / height;
+        m_columnA.resize(width);
+        m_rowA.resize(height);
+        for (int i=0; i<width; ++i) {
+            m_columnA[i] = (float)((i + 0.5) * invW - 1.0);
+        }
+        for (int j=0; j<height; ++j) {
+            m_rowA[j] = (float)((j + 0.5) * invH - 1.0);
+        }
+        const int quadrantWidth = (width + 1) / 2;
+        const int quadrantHeight = (height + 1) / 2;
+        m_quadrant.resize((size_t)2 * quadrantWidth * quadrantHeight);
+        // area elements of the corners of the rows above and below
+        std::vector<double> top(quadrantWidth + 1), bottom(quadrantWidth + 1);
+        for (int i=0; i<=quadrantWidth; ++i) {
+            top[i] = areaElement(i * invW - 1.0, -1.0);
+        }
+        for (int j=0; j<quadrantHeight; ++j) {
+            const double v1 = (j + 1) * invH - 1.0;
+            for (int i=0; i<=quadrantWidth; ++i) {
+                bottom[i] = areaElement(i * invW - 1.0, v1);
+            }
+            const double v = (j + 0.5) * invH - 1.0;
+            float* weight = &m_quadrant[(size_t)2 * j * quadrantWidth];
+            float* invLength = weight + quadrantWidth;
+            for (int i=0; i<quadrantWidth; ++i) {
+                const double u = (i + 0.5) * invW - 1.0;
+                weight[i] = (float)(top[i] - bottom[i] - top[i+1] + bottom[i+1]);
+                invLength[i] = (float)(1.0 / sqrt(u * u + v * v + 1.0));
+            }
+            top.swap(bottom);
+        }
+        return;
+    }
+    const double dPhi = PI_D / width;
+    const double phiOffset = mapping == MAPPING_HEMISPHERE_BACK ? PI_D : 0.0;
+    m_columnA.resize(width);
+    m_columnB.resize(width);
+    for (int i=0; i<width; ++i) {
+        const double phi = phiOffset + dPhi * (i + 0.5);
+        m_columnA[i] = (float)sin(phi);
+        m_columnB[i] = (float)cos(phi);
+    }
+    m_rowA.resize(height);
+    m_rowB.resize(height);
+    m_rowWeight.resize(height);
+    for (int j=0; j<height; ++j) {
+        const double theta = PI_D * (j + 0.5) / height;
+        m_rowA[j] = (float)sin(theta);
+        m_rowB[j] = (float)cos(theta);
+        m_rowWeight[j] = (float)(dPhi * (cos(PI_D * j / height) - cos(PI_D * (j + 1) / height)));
+    }
+}
+
+void TexelTable::ComputeRow(int row, int begin, int count, float* x, float* y, float* z, float* weight) const
+{
+    if (!IsCube()) {
+        const float sinTheta = m_rowA[row];
+        const float cosTheta = m_rowB[row];
+        const float w = m_rowWeight[row];
+        const float* sinPhi = &m_columnA[begin];
+        const float* cosPhi = &m_columnB[begin];
+        // separate loops, so each one vectorizes
+        for (int i=0; i<count; ++i) {
+            x[i] = sinTheta * sinPhi[i];
+        }
+        for (int i=0; i<count; ++i) {
+            z[i] = sinTheta * cosPhi[i];
+        }
+        std::fill(y, y + count, cosTheta);
+        std::fill(weight, weight + count, w);
+        return;
+    }
+    // the direction is (a u + b v + c) / |(u,v,1)|, with the axes of the face
+    const Vector3 c = cubeDirection(m_mapping, 0.f, 0.f);
+    const Vector3 a = cubeDirection(m_mapping, 1.f, 0.f) - c;
+    const Vector3 b = cubeDirection(m_mapping, 0.f, 1.f) - c;
+    const float v = m_rowA[row];
+    const float cx = b.GetX() * v + c.GetX();
+    const float cy = b.GetY() * v + c.GetY();
+    const float cz = b.GetZ() * v + c.GetZ();
+    const float ax = a.GetX(), ay = a.GetY(), az = a.GetZ();
+    const float* u = &m_columnA[begin];
+    const int quadrantWidth = (m_width + 1) / 2;
+    const int quadrantRow = row < (m_height + 1) / 2 ? row : m_height - 1 - row;
+    const float* quadrant = &m_quadrant[(size_t)2 * quadrantRow * quadrantWidth];
+    mirrorRow(quadrant, m_width, begin, count, weight);
+    // y holds the inverse lengths until the last loop
+    mirrorRow(quadrant + quadrantWidth, m_width, begin, count, y);
+    for (int i=0; i<count; ++i) {
+        x[i] = (ax * u[i] + cx) * y[i];
+    }
+    for (int i=0; i<count; ++i) {
+        z[i] = (az * u[i] + cz) * y[i];
+    }
+    for (int i=0; i<count; ++i) {
+        y[i] = (ay * u[i] + cy) * y[i];
+    }
+}
+
+size_t TexelTable::GetSize() const
+{
+    return sizeof(TexelTable) + sizeof(float) * (m_rowA.size() + m_rowB.size() + m_rowWeight.size()
+                                                 + m_columnA.size() + m_columnB.size() + m_quadrant.size());
+}
+
+MATH_NS_END
@@ -0,0 +1,88 @@
+//
+//  TexelTable.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+
+#ifndef MATH_TEXEL_TABLE_H_
+#define MATH_TEXEL_TABLE_H_
+
+#include <memory>
+#include <vector>
+#include "math/math_def.h"
+#include "math/Vector.h"
+
+MATH_NS_BEGIN
+
+/**
+ *  Direction and solid angle of every texel of an image mapped on the sphere,
+ *  computed a row at a time (@see ComputeRow) from separable terms:
+ *  hemispheres keep the inclination terms and weight of every row and the
+ *  azimuth terms of every column; cube faces keep the coordinates of every row
+ *  and column, and the weights and direction lengths of a quadrant, since they are symmetric.
+ *  Directions follow Spherical::ToVector3, and the weights of all the texels of
+ *  a full mapping add up to 4π.
+ *  Tables are immutable and cached per mapping and resolution (@see Get).
+ */
+class TexelTable {
+public:
+    enum Mapping {
+        /// half of an equirectangular map: inclination along the rows, azimuth along the columns, in [0,π) for the front and [π,2π) for the back
+        MAPPING_HEMISPHERE_FRONT = 0,
+        MAPPING_HEMISPHERE_BACK,
+        /// faces of a cube map, with the OpenGL orientation (rows go from top to bottom)
+        MAPPING_CUBE_POSITIVE_X,
+        MAPPING_CUBE_NEGATIVE_X,
+        MAPPING_CUBE_POSITIVE_Y,
+        MAPPING_CUBE_NEGATIVE_Y,
+        MAPPING_CUBE_POSITIVE_Z,
+        MAPPING_CUBE_NEGATIVE_Z
+    };
+    
+public:
+    /// Shared table for the given mapping and resolution; recently used tables are kept up to a memory budget
+    static std::shared_ptr<const TexelTable> Get(Mapping mapping, int width, int height);
+    /// Releases the cached tables that are not in use
+    static void ClearCache();
+    
+    /// Unit direction of the point (u,v) in [-1,1]^2 of a cube face (u to the right, v down)
+    static Vector3 GetCubeDirection(Mapping face, float u, float v);
+    
+public:
+    /// Computes the table; throws std::bad_alloc if it can't be allocated
+    TexelTable(Mapping mapping, int width, int height);
+    
+    /// Directions and weights of count texels of a row, starting at column begin
+    void ComputeRow(int row, int begin, int count, float* x, float* y, float* z, float* weight) const;
+    
+    // -----------------------------------------------------------
+    // getters
+    // -----------------------------------------------------------
+    inline Mapping GetMapping() const { return m_mapping; }
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+    inline bool IsCube() const { return m_mapping >= MAPPING_CUBE_POSITIVE_X; }
+    /// bytes held by the table
+    size_t GetSize() const;
+    
+private:
+    // non-copyable
+    TexelTable(const TexelTable&);
+    TexelTable& operator=(const TexelTable&);
+    
+private:
+    Mapping m_mapping;  ///< how the image is mapped on the sphere
+    int     m_width;    ///< Width of the image
+    int     m_height;   ///< Height of the image
+    std::vector<float> m_rowA;      ///< per row: sin θ (hemispheres) or v (cube faces)
+    std::vector<float> m_rowB;      ///< per row: cos θ (hemispheres)
+    std::vector<float> m_rowWeight; ///< per row: solid angle of its texels (hemispheres)
+    std::vector<float> m_columnA;   ///< per column: sin φ (hemispheres) or u (cube faces)
+    std::vector<float> m_columnB;   ///< per column: cos φ (hemispheres)
+    std::vector<float> m_quadrant;  ///< cube faces, top-left quadrant: (width+1)/2 solid angles and then inverse lengths of (u,v,1) per row
+}; // TexelTable
+
+MATH_NS_END
+
+#endif // MATH_TEXEL_TABLE_H_
@@ -300,7 +300,7 @@ inline Vector4 operator*(const float lhs, const Vector4& rhs) {
 /// dot product 
 inline float Dot(const Vector4& lhs, const Vector4& rhs) {
     return lhs.GetX() * rhs.GetX() + lhs.GetY() * rhs.GetY() 
-    + lhs.GetZ() * rhs.GetZ() + lhs.GetW() * lhs.GetW();
+    + lhs.GetZ() * rhs.GetZ() + lhs.GetW() * rhs.GetW();
 }
 /// dot product 
 inline float Dot(const Vector3& lhs, const Vector3& rhs) {
@@ -0,0 +1,92 @@
+//
+//  HdrImageTest.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Radiance HDR decoding of flat and old-style run-length encoded pixels,
+//  and rejection of malformed runs.
+//
+
+#include <string>
+#include <vector>
+#include "gfx/HdrImage.h"
+#include "Test.h"
+
+using namespace vd;
+
+namespace {
+
+    /// A 4x2 Radiance image with the given pixel data, 4 bytes per pixel or run
+    std::vector<unsigned char> radianceFile(const std::vector<unsigned char>& pixels)
+    {
+        const std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y 2 +X 4\n";
+        std::vector<unsigned char> file(header.begin(), header.end());
+        file.insert(file.end(), pixels.begin(), pixels.end());
+        return file;
+    }
+
+    /// Decodes the pixels; returns 1 if the result isn't the expected one
+    int decode(const std::vector<unsigned char>& pixels, bool valid, const char* what)
+    {
+        const std::vector<unsigned char> file = radianceFile(pixels);
+        gfx::HdrImage image;
+        const bool decoded = image.DecodeRadianceHDR(&file[0], file.size(), 1);
+        return test::Expect(decoded == valid, "%s: %s", what, decoded ? "decoded" : image.GetError().c_str());
+    }
+
+} // anonymous namespace
+
+namespace test {
+
+    int TestHdrImage()
+    {
+        int failures = 0;
+        // (1, 0.5, 0.25)
+        const unsigned char pixel[4] = { 128, 64, 32, 129 };
+        
+        // a pixel repeated 3 times, and then a flat scanline
+        std::vector<unsigned char> pixels(pixel, pixel + 4);
+        const unsigned char run3[4] = { 1, 1, 1, 3 };
+        pixels.insert(pixels.end(), run3, run3 + 4);
+        for (int i=0; i<4; ++i) {
+            pixels.insert(pixels.end(), pixel, pixel + 4);
+        }
+        const std::vector<unsigned char> file = radianceFile(pixels);
+        gfx::HdrImage image;
+        failures += Expect(image.DecodeRadianceHDR(&file[0], file.size(), 1), "old-style RLE: %s", image.GetError().c_str());
+        if (image.GetPixels() != NULL && image.GetWidth() == 4 && image.GetHeight() == 2) {
+            for (int i=0; i<8; ++i) {
+                const float* rgb = image.GetPixels() + i * 3;
+                failures += Expect(rgb[0] == 1.f && rgb[1] == 0.5f && rgb[2] == 0.25f,
+                                   "old-style RLE, pixel %d: (%g, %g, %g)", i, rgb[0], rgb[1], rgb[2]);
+            }
+        } else {
+            failures += Expect(false, "old-style RLE: wrong size");
+        }
+        
+        // a run longer than the rest of the scanline (the image is complete otherwise)
+        std::vector<unsigned char> overrun(pixel, pixel + 4);
+        const unsigned char run4[4] = { 1, 1, 1, 4 };
+        overrun.insert(overrun.end(), run4, run4 + 4);
+        for (int i=0; i<3; ++i) {
+            overrun.insert(overrun.end(), pixel, pixel + 4);
+        }
+        failures += decode(overrun, false, "run past the scanline");
+        
+        // 4 consecutive runs would shift the count by 24 bits
+        std::vector<unsigned char> shifted(pixel, pixel + 4);
+        const unsigned char run1[4] = { 1, 1, 1, 1 };
+        const unsigned char run0[4] = { 1, 1, 1, 0 };
+        shifted.insert(shifted.end(), run1, run1 + 4);
+        for (int i=0; i<3; ++i) {
+            shifted.insert(shifted.end(), run0, run0 + 4);
+        }
+        for (int i=0; i<6; ++i) {
+            shifted.insert(shifted.end(), pixel, pixel + 4);
+        }
+        failures += decode(shifted, false, "run count shifted by 24 bits");
+        return failures;
+    }
+
+} // namespace test
@@ -0,0 +1,88 @@
+//
+//  IrradianceTest.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  The batch GetIrradianceApproximation against the scalar one, for the
+//  quadratic form of 3 irradiance bands and the evaluation of any other count.
+//
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "math/SampleGenerator.h"
+#include "math/SimdFloat.h"
+#include "math/SphericalHarmonics.h"
+#include "Test.h"
+
+using namespace vd;
+
+namespace {
+
+    const double PI_D = 3.14159265358979323846;
+    /// max error relative to max(1, |scalar irradiance|); both run in float
+    const double TOLERANCE = 1e-5;
+    /// not a multiple of the SIMD width, so the scalar remainder runs too
+    const int NUM_DIRECTIONS = 8 * math::SimdFloat::WIDTH + 3;
+
+    /// a light with energy in every band: a bright lobe above, tinted sky and ground
+    math::Vector3 light(double theta, double phi)
+    {
+        const double lobe = pow(std::max(0.0, sin(theta) * cos(phi - 1.0)), 8.0);
+        return math::Vector3((float)(0.2 + 4.0 * lobe),
+                             (float)(0.5 + 0.4 * cos(theta)),
+                             (float)(0.3 + 0.2 * sin(theta) * sin(2.0 * phi)));
+    }
+
+    int checkBatch(const math::SphericalHarmonics& sh, const std::vector<float>& x,
+                   const std::vector<float>& y, const std::vector<float>& z)
+    {
+        std::vector<float> r(NUM_DIRECTIONS), g(NUM_DIRECTIONS), b(NUM_DIRECTIONS);
+        sh.GetIrradianceApproximation(NUM_DIRECTIONS, &x[0], &y[0], &z[0], &r[0], &g[0], &b[0]);
+        int failures = 0;
+        for (int i=0; i<NUM_DIRECTIONS; ++i) {
+            const math::Vector3 expected = sh.GetIrradianceApproximation(math::Vector3(x[i], y[i], z[i]));
+            const float batch[3] = { r[i], g[i], b[i] };
+            for (int c=0; c<3; ++c) {
+                const double tolerance = TOLERANCE * std::max(1.0, fabs((double)expected(c)));
+                failures += test::ExpectNear(batch[c], expected(c), tolerance,
+                                             "%d bands, %d irradiance bands, direction %d, channel %d",
+                                             sh.GetNumBands(), sh.GetIrradianceBands(), i, c);
+            }
+        }
+        return failures;
+    }
+
+} // anonymous namespace
+
+namespace test {
+
+    int TestIrradianceBatch()
+    {
+        std::vector<float> x(NUM_DIRECTIONS), y(NUM_DIRECTIONS), z(NUM_DIRECTIONS);
+        for (int i=0; i<NUM_DIRECTIONS; ++i) {
+            const double golden = 0.6180339887498949 * i;
+            const double theta = PI_D * i / (NUM_DIRECTIONS - 1);
+            const double phi = 2.0 * PI_D * (golden - floor(golden));
+            x[i] = (float)(sin(theta) * sin(phi));
+            y[i] = (float)cos(theta);
+            z[i] = (float)(sin(theta) * cos(phi));
+        }
+        int failures = 0;
+        // 3 bands: quadratic form
+        math::SphericalHarmonics sh3(3, math::SAMPLE_GENERATOR_SOBOL, 4096);
+        sh3.ProjectPolarFn(light);
+        failures += checkBatch(sh3, x, y, z);
+        // 5 bands: all of them evaluated, then the quadratic form of the first 3, then 2 bands
+        math::SphericalHarmonics sh5(5, math::SAMPLE_GENERATOR_SOBOL, 4096);
+        sh5.ProjectPolarFn(light);
+        const int irradianceBands[] = { 5, 3, 2 };
+        for (int k=0; k<3; ++k) {
+            sh5.SetIrradianceBands(irradianceBands[k]);
+            failures += checkBatch(sh5, x, y, z);
+        }
+        return failures;
+    }
+
+} // namespace test
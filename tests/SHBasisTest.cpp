@@ -0,0 +1,66 @@
+//
+//  SHBasisTest.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  SHBasisBatch against SphericalHarmonics::SH, the double-precision
+//  reference, for the closed forms (up to 4 bands) and the recurrence.
+//
+
+#include <math.h>
+#include <vector>
+#include "math/SHBasis.h"
+#include "math/SimdFloat.h"
+#include "math/SphericalHarmonics.h"
+#include "Test.h"
+
+using namespace vd;
+
+namespace {
+
+    const double PI_D = 3.14159265358979323846;
+    /// max absolute error of the float evaluation; |Y(l,m)| <= 1.33 up to 12 bands
+    const double TOLERANCE = 1e-5;
+    const int MAX_BANDS = 12;
+    /// not a multiple of the SIMD width, so the scalar remainder runs too
+    const int NUM_DIRECTIONS = 8 * math::SimdFloat::WIDTH + 3;
+
+} // anonymous namespace
+
+namespace test {
+
+    int TestSHBasisBatch()
+    {
+        // theta covers both poles; phi follows the golden ratio
+        std::vector<double> theta(NUM_DIRECTIONS), phi(NUM_DIRECTIONS);
+        std::vector<float> x(NUM_DIRECTIONS), y(NUM_DIRECTIONS), z(NUM_DIRECTIONS);
+        for (int i=0; i<NUM_DIRECTIONS; ++i) {
+            const double golden = 0.6180339887498949 * i;
+            theta[i] = PI_D * i / (NUM_DIRECTIONS - 1);
+            phi[i] = 2.0 * PI_D * (golden - floor(golden));
+            x[i] = (float)(sin(theta[i]) * sin(phi[i]));
+            y[i] = (float)cos(theta[i]);
+            z[i] = (float)(sin(theta[i]) * cos(phi[i]));
+        }
+        // a stride larger than the count, as the sample sets use
+        const size_t stride = NUM_DIRECTIONS + 5;
+        int failures = 0;
+        for (int numBands = 1; numBands <= MAX_BANDS; ++numBands) {
+            std::vector<float> basis(numBands * numBands * stride, 0.f);
+            math::SHBasisBatch(numBands, NUM_DIRECTIONS, &x[0], &y[0], &z[0], &basis[0], stride);
+            for (int l=0; l<numBands; ++l) {
+                for (int m=-l; m<=l; ++m) {
+                    const size_t n = l*(l+1)+m;
+                    for (int i=0; i<NUM_DIRECTIONS; ++i) {
+                        const double expected = math::SphericalHarmonics::SH(l, m, theta[i], phi[i]);
+                        failures += ExpectNear(basis[n * stride + i], expected, TOLERANCE,
+                                               "%d bands, Y(%d,%d) at direction %d", numBands, l, m, i);
+                    }
+                }
+            }
+        }
+        return failures;
+    }
+
+} // namespace test
@@ -0,0 +1,154 @@
+//
+//  SHJobQueueTest.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  SHJobQueue: results of the submitted projections, progress reporting,
+//  cancellation of pending and running jobs, and failures.
+//
+
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "math/SHJobQueue.h"
+#include "Test.h"
+
+using namespace vd;
+
+namespace {
+
+    const double PI_D = 3.14159265358979323846;
+    /// generous, so a slow machine doesn't fail; a hang still ends the test
+    const double TIMEOUT = 30.0;
+
+    math::Vector3 sky(double theta, double phi)
+    {
+        return math::Vector3((float)(1.0 + cos(theta)), (float)(0.5 + 0.5 * sin(theta) * cos(phi)), 0.25f);
+    }
+
+    bool sameCoeffs(const math::SphericalHarmonics& a, const math::SphericalHarmonics& b)
+    {
+        if (a.GetNumCoeffs() != b.GetNumCoeffs()) return false;
+        for (int n=0; n<a.GetNumCoeffs(); ++n) {
+            for (int c=0; c<3; ++c) {
+                if (a.GetCoeffs()[n](c) != b.GetCoeffs()[n](c)) return false;
+            }
+        }
+        return true;
+    }
+
+    /// Waits until the condition holds or the timeout runs out
+    template <typename Condition>
+    bool waitUntil(Condition condition)
+    {
+        for (int i=0; i<(int)(TIMEOUT * 1000) && !condition(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return condition();
+    }
+
+    int testResults(math::SHJobQueue& queue)
+    {
+        int failures = 0;
+        // polar function: the same coefficients as ProjectPolarFn
+        const math::SHJobDesc desc(3, math::SAMPLE_GENERATOR_SOBOL, 5000);
+        std::shared_ptr<math::SHJob> job = queue.SubmitPolarFn(desc, sky);
+        failures += test::Expect(job->WaitFor(TIMEOUT), "polar job didn't finish");
+        failures += test::Expect(job->GetState() == math::SH_JOB_DONE, "polar job state %d", job->GetState());
+        failures += test::Expect(job->GetProgress() == 1.f, "polar job progress %g", job->GetProgress());
+        math::SphericalHarmonics reference(desc.numBands, desc.generator, desc.numSamples, desc.seed);
+        reference.ProjectPolarFn(sky);
+        failures += test::Expect(job->GetResult() && sameCoeffs(*job->GetResult(), reference),
+                                 "polar job differs from ProjectPolarFn");
+        
+        // equirect map: bit-identical to ProjectEquirect
+        const int w = 64, h = 32;
+        std::vector<float> pixels(w * h * 3);
+        for (int j=0; j<h; ++j) {
+            for (int i=0; i<w; ++i) {
+                const math::Vector3 c = sky(PI_D * (j + 0.5) / h, 2.0 * PI_D * (i + 0.5) / w);
+                for (int k=0; k<3; ++k) pixels[(j * w + i) * 3 + k] = c(k);
+            }
+        }
+        const math::RadianceImage image(&pixels[0], w, h);
+        job = queue.SubmitEquirect(math::SHJobDesc(4), image);
+        failures += test::Expect(job->Wait(), "equirect job state %d", job->GetState());
+        math::SphericalHarmonics texels(4, math::SphericalHarmonics::TEXELS_ONLY);
+        texels.ProjectEquirect(image);
+        failures += test::Expect(job->GetResult() && sameCoeffs(*job->GetResult(), texels),
+                                 "equirect job differs from ProjectEquirect");
+        // odd widths can't be split in hemispheres
+        job = queue.SubmitEquirect(math::SHJobDesc(4), math::RadianceImage(&pixels[0], w - 1, h));
+        failures += test::Expect(!job->Wait() && job->GetState() == math::SH_JOB_FAILED,
+                                 "odd-width equirect job state %d", job->GetState());
+        return failures;
+    }
+
+    int testProgressAndCancel(math::SHJobQueue& queue)
+    {
+        int failures = 0;
+        // occupies the only worker until it is cancelled, reporting half the work done
+        std::atomic<bool> started(false);
+        std::shared_ptr<math::SHJob> running = queue.Submit([&started](math::SHJob& job) {
+            job.SetProgress(0.5f);
+            started.store(true);
+            while (!job.IsCancelRequested()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return std::shared_ptr<math::SphericalHarmonics>();
+        });
+        std::shared_ptr<math::SHJob> pending = queue.SubmitPolarFn(math::SHJobDesc(), sky);
+        failures += test::Expect(waitUntil([&started]() { return started.load(); }), "job didn't start");
+        failures += test::Expect(running->GetState() == math::SH_JOB_RUNNING, "running job state %d", running->GetState());
+        failures += test::Expect(running->GetProgress() == 0.5f, "running job progress %g", running->GetProgress());
+        failures += test::Expect(queue.GetNumPending() == 1, "%d pending jobs", queue.GetNumPending());
+        
+        // a pending job is cancelled right away
+        pending->Cancel();
+        failures += test::Expect(pending->GetState() == math::SH_JOB_CANCELLED, "pending job state %d", pending->GetState());
+        failures += test::Expect(!pending->GetResult(), "cancelled job has a result");
+        // a running one when it checks
+        failures += test::Expect(!running->IsFinished(), "running job finished early");
+        running->Cancel();
+        failures += test::Expect(running->WaitFor(TIMEOUT), "cancelled job didn't finish");
+        failures += test::Expect(running->GetState() == math::SH_JOB_CANCELLED, "running job state %d", running->GetState());
+        queue.WaitAll();
+        failures += test::Expect(queue.GetNumPending() == 0, "%d pending jobs", queue.GetNumPending());
+        return failures;
+    }
+
+    int testFailure(math::SHJobQueue& queue)
+    {
+        int failures = 0;
+        std::shared_ptr<math::SHJob> job = queue.Submit([](math::SHJob&) -> std::shared_ptr<math::SphericalHarmonics> {
+            throw std::runtime_error("no probe");
+        });
+        failures += test::Expect(!job->Wait() && job->GetState() == math::SH_JOB_FAILED, "throwing job state %d", job->GetState());
+        failures += test::Expect(job->GetError() == "no probe", "throwing job error '%s'", job->GetError().c_str());
+        // the worker survives
+        job = queue.SubmitPolarFn(math::SHJobDesc(2, math::SAMPLE_GENERATOR_SOBOL, 1024), sky);
+        failures += test::Expect(job->WaitFor(TIMEOUT) && job->GetState() == math::SH_JOB_DONE,
+                                 "job after a failure state %d", job->GetState());
+        return failures;
+    }
+
+} // anonymous namespace
+
+namespace test {
+
+    int TestSHJobQueue()
+    {
+        // a single worker, so jobs queue up behind each other
+        math::SHJobQueue queue(1);
+        int failures = 0;
+        failures += testResults(queue);
+        failures += testProgressAndCancel(queue);
+        failures += testFailure(queue);
+        return failures;
+    }
+
+} // namespace test
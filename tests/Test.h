@@ -0,0 +1,33 @@
+//
+//  Test.h
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Minimal test harness: every test is a function that returns its number
+//  of failed checks, and shtests runs the ones named on the command line.
+//
+
+#ifndef TESTS_TEST_H_
+#define TESTS_TEST_H_
+
+namespace test {
+
+    typedef int (*TestFn)();
+
+    /// Prints the failure message (printf format) unless the condition holds; returns 1 if it failed
+    int Expect(bool condition, const char* format, ...);
+
+    /// Expect(|actual - expected| <= tolerance), reporting both values
+    int ExpectNear(double actual, double expected, double tolerance, const char* format, ...);
+
+    // tests, one function per test source
+    int TestSHBasisBatch();
+    int TestIrradianceBatch();
+    int TestSHJobQueue();
+    int TestTexelProjection();
+    int TestHdrImage();
+
+} // namespace test
+
+#endif // TESTS_TEST_H_
@@ -0,0 +1,212 @@
+//
+//  TexelProjectionTest.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Projections of every texel of equirect and cube maps: a constant map
+//  must give the constant's coefficient, invalid sizes fail, the texel tables
+//  match the direct computation and region updates match full projections.
+//
+
+#include <math.h>
+#include <vector>
+#include "math/SphericalHarmonics.h"
+#include "math/TexelTable.h"
+#include "Test.h"
+
+using namespace vd;
+
+namespace {
+
+    const double PI_D = 3.14159265358979323846;
+    /// the solid angles are exact, so Y(0,0) only has float rounding
+    const double TOLERANCE = 1e-5;
+
+    /**
+     * Coefficients of a constant color: only Y(0,0) = 1/sqrt(4π), so c * sqrt(4π).
+     * The basis is evaluated at the texel centers, so the other coefficients
+     * have the error of the midpoint rule, up to zonalTolerance per unit of color for m = 0.
+     */
+    int checkConstant(const math::SphericalHarmonics& sh, const math::Vector3* coeffs,
+                      const math::Vector3& color, double zonalTolerance, const char* what)
+    {
+        if (coeffs == NULL) {
+            return test::Expect(false, "%s: no coefficients", what);
+        }
+        int failures = 0;
+        for (int n=0; n<sh.GetNumCoeffs(); ++n) {
+            for (int c=0; c<3; ++c) {
+                const int l = (int)sqrt((double)n);
+                const bool zonal = n > 0 && n == l * (l + 1);
+                const double expected = n == 0 ? color(c) * sqrt(4.0 * PI_D) : 0.0;
+                failures += test::ExpectNear(coeffs[n](c), expected, zonal ? zonalTolerance * color(c) : TOLERANCE,
+                                             "%s, coefficient %d, channel %d", what, n, c);
+            }
+        }
+        return failures;
+    }
+
+    /// Solid angle subtended by the rectangle (0,0)-(x,y) of the plane z=1
+    double areaElement(double x, double y)
+    {
+        return atan2(x * y, sqrt(x * x + y * y + 1.0));
+    }
+    
+    /// Rows computed from the tables, also in pieces, against the direct computation
+    int testTables()
+    {
+        int failures = 0;
+        // odd sizes, so the middle row and column of the cube quadrants are covered
+        const int size = 7;
+        const int w = 9, h = 5;
+        std::vector<float> x(w), y(w), z(w), weight(w);
+        double total = 0.0;
+        for (int m = math::TexelTable::MAPPING_CUBE_POSITIVE_X; m <= math::TexelTable::MAPPING_CUBE_NEGATIVE_Z; ++m) {
+            const math::TexelTable::Mapping face = (math::TexelTable::Mapping)m;
+            std::shared_ptr<const math::TexelTable> table = math::TexelTable::Get(face, size, size);
+            failures += test::Expect(table == math::TexelTable::Get(face, size, size), "face %d: table not shared", m);
+            for (int j=0; j<size; ++j) {
+                // columns [2, size) only, to check the offset
+                table->ComputeRow(j, 2, size - 2, &x[0], &y[0], &z[0], &weight[0]);
+                for (int i=2; i<size; ++i) {
+                    const double u0 = 2.0 * i / size - 1.0, u1 = 2.0 * (i + 1) / size - 1.0;
+                    const double v0 = 2.0 * j / size - 1.0, v1 = 2.0 * (j + 1) / size - 1.0;
+                    const double expected = areaElement(u0, v0) - areaElement(u0, v1) - areaElement(u1, v0) + areaElement(u1, v1);
+                    const math::Vector3 d = math::TexelTable::GetCubeDirection(face, (float)(0.5 * (u0 + u1)), (float)(0.5 * (v0 + v1)));
+                    failures += test::ExpectNear(weight[i-2], expected, 1e-6, "face %d, texel (%d,%d): weight", m, i, j);
+                    failures += test::ExpectNear(x[i-2], d.GetX(), 1e-6, "face %d, texel (%d,%d): x", m, i, j);
+                    failures += test::ExpectNear(y[i-2], d.GetY(), 1e-6, "face %d, texel (%d,%d): y", m, i, j);
+                    failures += test::ExpectNear(z[i-2], d.GetZ(), 1e-6, "face %d, texel (%d,%d): z", m, i, j);
+                }
+                table->ComputeRow(j, 0, size, &x[0], &y[0], &z[0], &weight[0]);
+                for (int i=0; i<size; ++i) {
+                    total += weight[i];
+                }
+            }
+        }
+        for (int m = math::TexelTable::MAPPING_HEMISPHERE_FRONT; m <= math::TexelTable::MAPPING_HEMISPHERE_BACK; ++m) {
+            std::shared_ptr<const math::TexelTable> table = math::TexelTable::Get((math::TexelTable::Mapping)m, w, h);
+            for (int j=0; j<h; ++j) {
+                table->ComputeRow(j, 0, w, &x[0], &y[0], &z[0], &weight[0]);
+                const double theta = PI_D * (j + 0.5) / h;
+                const double expected = PI_D / w * (cos(PI_D * j / h) - cos(PI_D * (j + 1) / h));
+                for (int i=0; i<w; ++i) {
+                    const double phi = PI_D * (m + (i + 0.5) / w);
+                    failures += test::ExpectNear(weight[i], expected, 1e-6, "hemisphere %d, texel (%d,%d): weight", m, i, j);
+                    failures += test::ExpectNear(x[i], sin(theta) * sin(phi), 1e-6, "hemisphere %d, texel (%d,%d): x", m, i, j);
+                    failures += test::ExpectNear(y[i], cos(theta), 1e-6, "hemisphere %d, texel (%d,%d): y", m, i, j);
+                    failures += test::ExpectNear(z[i], sin(theta) * cos(phi), 1e-6, "hemisphere %d, texel (%d,%d): z", m, i, j);
+                }
+            }
+        }
+        failures += test::ExpectNear(total, 4.0 * PI_D, 1e-5, "solid angle of the cube");
+        return failures;
+    }
+    
+    /// Region updates against full projections of the changed images
+    int testRegionUpdates()
+    {
+        int failures = 0;
+        math::SphericalHarmonics sh(3, math::SphericalHarmonics::TEXELS_ONLY);
+        math::SphericalHarmonics full(3, math::SphericalHarmonics::TEXELS_ONLY);
+        
+        // equirect: a rectangle across the middle of the map
+        const int w = 32, h = 15;
+        std::vector<float> pixels((size_t)w * h * 3);
+        for (size_t i=0; i<pixels.size(); ++i) pixels[i] = (float)((i * 7) % 11) / 11.f;
+        const math::RadianceImage image(&pixels[0], w, h);
+        sh.ProjectEquirect(image);
+        const int rx = 13, ry = 4, rw = 7, rh = 6;
+        std::vector<float> before((size_t)rw * rh * 3), after((size_t)rw * rh * 3);
+        for (int j=0; j<rh; ++j) {
+            for (int i=0; i<rw; ++i) {
+                for (int c=0; c<3; ++c) {
+                    float& p = pixels[((size_t)(ry + j) * w + rx + i) * 3 + c];
+                    before[((size_t)j * rw + i) * 3 + c] = p;
+                    p = after[((size_t)j * rw + i) * 3 + c] = 2.f + c - 0.1f * i;
+                }
+            }
+        }
+        sh.UpdateEquirectRegion(w, h, rx, ry, math::RadianceImage(&before[0], rw, rh), math::RadianceImage(&after[0], rw, rh));
+        full.ProjectEquirect(image);
+        for (int n=0; n<sh.GetNumCoeffs(); ++n) {
+            for (int c=0; c<3; ++c) {
+                failures += test::ExpectNear(sh.GetCoeffs()[n](c), full.GetCoeffs()[n](c), TOLERANCE,
+                                             "equirect update, coefficient %d, channel %d", n, c);
+            }
+        }
+        
+        // cube: a rectangle in the bottom right quadrant of an odd-sized face
+        const int size = 9;
+        std::vector<float> strip((size_t)size * size * 6 * 3);
+        for (size_t i=0; i<strip.size(); ++i) strip[i] = (float)((i * 5) % 13) / 13.f;
+        const math::RadianceImage cube(&strip[0], size, 6 * size);
+        math::RadianceImage faces[6];
+        for (int k=0; k<6; ++k) {
+            faces[k] = cube.GetRegion(0, k * size, size, size);
+        }
+        sh.ProjectCubeMap(faces);
+        const int cx = 3, cy = 5, cw = 6, ch = 4, face = 4;
+        std::vector<float> oldFace(strip.begin() + (size_t)face * size * size * 3, strip.begin() + (size_t)(face + 1) * size * size * 3);
+        for (int j=0; j<ch; ++j) {
+            for (int i=0; i<cw; ++i) {
+                float* p = &strip[((size_t)(face * size + cy + j) * size + cx + i) * 3];
+                p[0] += 1.f;
+                p[2] -= 0.5f * j;
+            }
+        }
+        const math::RadianceImage oldImage(&oldFace[0], size, size);
+        sh.UpdateTexelRegion(math::TexelTable::MAPPING_CUBE_POSITIVE_Z, size, size, cx, cy,
+                             oldImage.GetRegion(cx, cy, cw, ch), faces[face].GetRegion(cx, cy, cw, ch));
+        full.ProjectCubeMap(faces);
+        for (int n=0; n<sh.GetNumCoeffs(); ++n) {
+            for (int c=0; c<3; ++c) {
+                failures += test::ExpectNear(sh.GetCoeffs()[n](c), full.GetCoeffs()[n](c), TOLERANCE,
+                                             "cube update, coefficient %d, channel %d", n, c);
+            }
+        }
+        return failures;
+    }
+
+} // anonymous namespace
+
+namespace test {
+
+    int TestTexelProjection()
+    {
+        const math::Vector3 color(0.25f, 0.5f, 1.f);
+        int failures = 0;
+        math::SphericalHarmonics sh(4, math::SphericalHarmonics::TEXELS_ONLY);
+        
+        // equirect, with an odd height
+        const int w = 64, h = 31;
+        std::vector<float> pixels((size_t)w * h * 3);
+        for (size_t i=0; i<pixels.size(); ++i) pixels[i] = color(i % 3);
+        // the error of Y(2,0) is about 3.3 / h^2 per unit of color
+        failures += checkConstant(sh, sh.ProjectEquirect(math::RadianceImage(&pixels[0], w, h)), color,
+                                  5.0 / (h * h), "equirect");
+        // the last column of an odd width would be lost
+        failures += Expect(sh.ProjectEquirect(math::RadianceImage(&pixels[0], w - 1, h, 3, w * 3)) == NULL,
+                           "odd-width equirect projected");
+        failures += Expect(sh.UpdateEquirectRegion(w - 1, h, 0, 0, math::RadianceImage(&pixels[0], 2, 2),
+                                                   math::RadianceImage(&pixels[0], 2, 2)) == NULL,
+                           "odd-width equirect updated");
+        
+        // cube map
+        const int size = 24;
+        std::vector<float> strip((size_t)size * size * 6 * 3);
+        for (size_t i=0; i<strip.size(); ++i) strip[i] = color(i % 3);
+        const math::RadianceImage image(&strip[0], size, 6 * size);
+        math::RadianceImage faces[6];
+        for (int k=0; k<6; ++k) {
+            faces[k] = image.GetRegion(0, k * size, size, size);
+        }
+        failures += checkConstant(sh, sh.ProjectCubeMap(faces), color, TOLERANCE, "cube");
+        
+        failures += testTables();
+        failures += testRegionUpdates();
+        return failures;
+    }
+
+} // namespace test
@@ -0,0 +1,107 @@
+//
+//  main.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Runs the named tests, or all of them without arguments. Each one is also
+//  registered with ctest on its own (see CMakeLists.txt).
+//
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "math/SimdFloat.h"
+#include "Test.h"
+
+namespace {
+
+    struct TestCase {
+        const char*     name;
+        test::TestFn    fn;
+    };
+
+    const TestCase TESTS[] = {
+        { "SHBasisBatch", test::TestSHBasisBatch },
+        { "IrradianceBatch", test::TestIrradianceBatch },
+        { "SHJobQueue", test::TestSHJobQueue },
+        { "TexelProjection", test::TestTexelProjection },
+        { "HdrImage", test::TestHdrImage },
+    };
+    const int NUM_TESTS = (int)(sizeof(TESTS) / sizeof(TESTS[0]));
+
+    /// Whether this CPU runs the instruction set the SIMD code was compiled for
+    bool isSimdSupported()
+    {
+#if MATH_SIMD_AVX2 && (defined(__GNUC__) || defined(__clang__))
+        return __builtin_cpu_supports("avx2");
+#else
+        return true;
+#endif
+    }
+
+    int runTest(const TestCase& t)
+    {
+        const int failures = t.fn();
+        printf("%-24s %s", t.name, failures == 0 ? "ok\n" : "FAILED");
+        if (failures > 0) {
+            printf(" (%d)\n", failures);
+        }
+        return failures;
+    }
+
+} // anonymous namespace
+
+namespace test {
+
+    int Expect(bool condition, const char* format, ...)
+    {
+        if (condition) return 0;
+        va_list args;
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+        printf("\n");
+        return 1;
+    }
+
+    int ExpectNear(double actual, double expected, double tolerance, const char* format, ...)
+    {
+        const double error = fabs(actual - expected);
+        if (error <= tolerance) return 0;
+        va_list args;
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+        printf(": %.9g, expected %.9g (error %.3g > %.3g)\n", actual, expected, error, tolerance);
+        return 1;
+    }
+
+} // namespace test
+
+int main(int argc, char** argv)
+{
+    if (!isSimdSupported()) {
+        printf("skipped: the CPU can't run %d-wide SIMD\n", vd::math::SimdFloat::WIDTH);
+        return 77;
+    }
+    printf("SIMD width: %d\n", vd::math::SimdFloat::WIDTH);
+    int failures = 0;
+    if (argc < 2) {
+        for (int i=0; i<NUM_TESTS; ++i) {
+            failures += runTest(TESTS[i]);
+        }
+        return failures == 0 ? 0 : 1;
+    }
+    for (int a=1; a<argc; ++a) {
+        int i = 0;
+        while (i < NUM_TESTS && strcmp(TESTS[i].name, argv[a]) != 0) ++i;
+        if (i == NUM_TESTS) {
+            fprintf(stderr, "unknown test: %s\n", argv[a]);
+            return 2;
+        }
+        failures += runTest(TESTS[i]);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,490 @@
+//
+//  shaccuracy.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Accuracy versus cost: projects analytic functions with known SH
+//  coefficients through every sampling and projection mode, for sweeps of
+//  band counts, sample counts and image sizes, and tabulates the error of
+//  every configuration against its wall time. The configurations that no
+//  other one beats in both error and time form the Pareto frontier.
+//  Times are of the projection alone: sample sets, radiance at the samples
+//  and rasterized images are prepared beforehand. The progressive mode is
+//  the exception, since choosing when to stop is part of its cost.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include "math/SampleGenerator.h"
+#include "math/SphericalHarmonics.h"
+#include "math/TexelTable.h"
+
+using namespace vd;
+
+namespace {
+
+    const double PI_D = 3.14159265358979323846;
+
+    enum OutputFormat {
+        FORMAT_TEXT = 0,
+        FORMAT_CSV
+    };
+
+    /**
+     * A function of the sphere with known SH coefficients: a color times a
+     * scalar function, so the coefficients of every channel are proportional.
+     */
+    struct TestFunction {
+        std::string     name;
+        math::Vector3   color;
+        /// scalar part, at a unit direction (as in Spherical::ToVector3)
+        std::function<double(double x, double y, double z)> eval;
+        /// exact coefficient n = l(l+1)+m of the scalar part
+        std::function<double(int l, int m)> coeff;
+        /// squared L2 norm of the scalar part over the sphere
+        double          normSq;
+    };
+
+    struct Options {
+        std::vector<int>    bands;
+        std::vector<int>    samples;
+        std::vector<int>    heights;        ///< equirect maps are 2h x h
+        std::vector<int>    faces;          ///< cube face sizes
+        std::vector<double> targets;        ///< of the progressive projection
+        std::string         filter;         ///< of the test functions
+        OutputFormat        format;
+        double              minTime;
+        double              errorBar;       ///< 0 if not given
+        int                 numThreads;
+
+        Options()
+        : format(FORMAT_TEXT), minTime(0.02), errorBar(0.0), numThreads(1)
+        {}
+    };
+
+    /// A measured configuration
+    struct Result {
+        std::string function;
+        std::string mode;
+        int         bands;
+        int         samples;        ///< samples, or texels of the images
+        double      coeffError;     ///< relative L2 error of the projected coefficients
+        double      functionError;  ///< relative L2 error of the reconstruction, truncation included
+        double      seconds;        ///< mean wall time of a projection
+        bool        pareto;         ///< no other result of the function is both faster and more accurate
+    };
+
+    /// Function being projected by polarSampler
+    const TestFunction* g_function = NULL;
+
+    math::Vector3 polarSampler(double theta, double phi)
+    {
+        const double s = sin(theta);
+        const float v = (float)g_function->eval(s * sin(phi), cos(theta), s * cos(phi));
+        return v * g_function->color;
+    }
+
+    std::vector<TestFunction> makeFunctions()
+    {
+        std::vector<TestFunction> functions;
+
+        // a constant projects to band 0 only: Y00 = 1/sqrt(4π)
+        TestFunction constant;
+        constant.name = "constant";
+        constant.color = math::Vector3(0.8f, 0.6f, 0.4f);
+        constant.eval = [](double, double, double) { return 1.0; };
+        constant.coeff = [](int l, int) { return l == 0 ? sqrt(4.0 * PI_D) : 0.0; };
+        constant.normSq = 4.0 * PI_D;
+        functions.push_back(constant);
+
+        // single basis functions are orthonormal
+        const int basis[2][2] = { { 2, 1 }, { 4, -3 } };
+        for (int i=0; i<2; ++i) {
+            const int bl = basis[i][0], bm = basis[i][1];
+            TestFunction f;
+            char name[32];
+            snprintf(name, sizeof(name), "Y(%d,%d)", bl, bm);
+            f.name = name;
+            f.color = math::Vector3(1.f, 0.5f, 0.25f);
+            f.eval = [bl, bm](double x, double y, double z) {
+                const double theta = acos(std::max(-1.0, std::min(1.0, y)));
+                double phi = atan2(x, z);
+                if (phi < 0.0) phi += 2.0 * PI_D;
+                return math::SphericalHarmonics::SH(bl, bm, theta, phi);
+            };
+            f.coeff = [bl, bm](int l, int m) { return l == bl && m == bm ? 1.0 : 0.0; };
+            f.normSq = 1.0;
+            functions.push_back(f);
+        }
+
+        // clamped cosine lobe around a tilted axis: it has energy in every even band,
+        // c_lm = A_l * Y_lm(axis), with the A_l of ClampedCosineZonal
+        const math::Vector3 axis = math::Vector3(0.3f, 0.8f, 0.5f).Normalize();
+        const double ax = axis.GetX(), ay = axis.GetY(), az = axis.GetZ();
+        TestFunction lobe;
+        lobe.name = "cosine lobe";
+        lobe.color = math::Vector3(0.9f, 0.7f, 0.3f);
+        lobe.eval = [ax, ay, az](double x, double y, double z) { return std::max(0.0, x * ax + y * ay + z * az); };
+        lobe.coeff = [ax, ay, az](int l, int m) {
+            double phi = atan2(ax, az);
+            if (phi < 0.0) phi += 2.0 * PI_D;
+            return math::SphericalHarmonics::ClampedCosineZonal(l) * math::SphericalHarmonics::SH(l, m, acos(ay), phi);
+        };
+        lobe.normSq = 2.0 * PI_D / 3.0;
+        functions.push_back(lobe);
+
+        return functions;
+    }
+
+    /**
+     * Relative L2 errors of the coefficients of sh against the exact ones,
+     * over the projected bands, and of the reconstructed function, where the
+     * energy of the bands that were not projected adds to the error.
+     */
+    void measureError(const TestFunction& f, const math::SphericalHarmonics& sh, double* coeffError, double* functionError)
+    {
+        double errorSq = 0.0, exactSq = 0.0;
+        for (int l=0; l<sh.GetNumBands(); ++l) {
+            for (int m=-l; m<=l; ++m) {
+                const double exact = f.coeff(l, m);
+                const math::Vector3& c = sh.GetCoeffs()[l * (l + 1) + m];
+                for (int k=0; k<3; ++k) {
+                    const double e = c(k) - exact * f.color(k);
+                    errorSq += e * e;
+                    exactSq += (exact * f.color(k)) * (exact * f.color(k));
+                }
+            }
+        }
+        double colorSq = 0.0;
+        for (int k=0; k<3; ++k) {
+            colorSq += (double)f.color(k) * f.color(k);
+        }
+        const double normSq = f.normSq * colorSq;
+        // energy of the bands that were not projected; below the rounding error, there is none
+        double truncatedSq = normSq - exactSq;
+        if (truncatedSq < 1e-12 * normSq) truncatedSq = 0.0;
+        *coeffError = sqrt(errorSq / (exactSq > 0.0 ? exactSq : normSq));
+        *functionError = sqrt((errorSq + truncatedSq) / normSq);
+    }
+
+    /// Mean wall time of op, run at least once and for at least minTime
+    double timeOp(const std::function<void()>& op, double minTime)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point start = Clock::now();
+        int count = 0;
+        double elapsed = 0.0;
+        do {
+            op();
+            ++count;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < minTime);
+        return elapsed / count;
+    }
+
+    /// Equirectangular map of the function, evaluated at the texel centers
+    std::vector<float> rasterEquirect(const TestFunction& f, int width, int height)
+    {
+        std::vector<float> pixels((size_t)width * height * 3);
+        for (int y=0; y<height; ++y) {
+            const double theta = PI_D * (y + 0.5) / height;
+            for (int x=0; x<width; ++x) {
+                const double phi = 2.0 * PI_D * (x + 0.5) / width;
+                const math::Vector3 c = (float)f.eval(sin(theta) * sin(phi), cos(theta), sin(theta) * cos(phi)) * f.color;
+                float* p = &pixels[3 * ((size_t)y * width + x)];
+                p[0] = c.GetX(); p[1] = c.GetY(); p[2] = c.GetZ();
+            }
+        }
+        return pixels;
+    }
+
+    /// Cube map of the function, faces stacked vertically, evaluated at the texel centers
+    std::vector<float> rasterCube(const TestFunction& f, int size)
+    {
+        std::vector<float> pixels((size_t)size * size * 6 * 3);
+        for (int face=0; face<6; ++face) {
+            const math::TexelTable::Mapping mapping = (math::TexelTable::Mapping)(math::TexelTable::MAPPING_CUBE_POSITIVE_X + face);
+            for (int y=0; y<size; ++y) {
+                for (int x=0; x<size; ++x) {
+                    const math::Vector3 d = math::TexelTable::GetCubeDirection(mapping, 2.f * (x + 0.5f) / size - 1.f,
+                                                                              2.f * (y + 0.5f) / size - 1.f);
+                    const math::Vector3 c = (float)f.eval(d.GetX(), d.GetY(), d.GetZ()) * f.color;
+                    float* p = &pixels[3 * (((size_t)face * size + y) * size + x)];
+                    p[0] = c.GetX(); p[1] = c.GetY(); p[2] = c.GetZ();
+                }
+            }
+        }
+        return pixels;
+    }
+
+    class Harness {
+    public:
+        explicit Harness(const Options& options) : m_options(options) {}
+
+        const std::vector<Result>& GetResults() const { return m_results; }
+
+        /// Every mode and size, for a function and a band count
+        void Run(const TestFunction& f, int bands)
+        {
+            g_function = &f;
+            // point sampling, with every generator; the sample sets are built
+            // and the function is evaluated before timing, the same as the
+            // images are rasterized before timing the texel integration
+            for (int gen=0; gen<math::NUM_SAMPLE_GENERATORS; ++gen) {
+                for (size_t s=0; s<m_options.samples.size(); ++s) {
+                    math::SphericalHarmonics sh(bands, (math::SampleGenerator)gen, m_options.samples[s], 1);
+                    sh.SetNumThreads(m_options.numThreads);
+                    std::vector<math::Vector3> radiance(sh.GetNumSamples());
+                    for (int i=0; i<sh.GetNumSamples(); ++i) {
+                        radiance[i] = polarSampler(sh.GetSamples().GetTheta()[i], sh.GetSamples().GetPhi()[i]);
+                    }
+                    const double seconds = timeOp([&sh, &radiance]() { sh.ProjectRadiance(&radiance[0]); }, m_options.minTime);
+                    add(f, std::string("polar/") + math::GetSampleGeneratorName((math::SampleGenerator)gen),
+                        sh, sh.GetNumSamples(), seconds);
+                }
+            }
+            // progressive Sobol projection, up to the largest sample count; it
+            // evaluates the function as it goes, so its time includes that
+            const int maxSamples = *std::max_element(m_options.samples.begin(), m_options.samples.end());
+            for (size_t t=0; t<m_options.targets.size(); ++t) {
+                math::SphericalHarmonics sh(bands, math::SAMPLE_GENERATOR_SOBOL, maxSamples, 1);
+                sh.SetNumThreads(m_options.numThreads);
+                const double target = m_options.targets[t];
+                int used = 0;
+                const double seconds = timeOp([&sh, &used, target]() {
+                    used = sh.ProjectPolarFnProgressive(&polarSampler, target).numSamples;
+                }, m_options.minTime);
+                char mode[64];
+                snprintf(mode, sizeof(mode), "progressive/%g", target);
+                add(f, mode, sh, used, seconds);
+            }
+            // exact texel integration of rasterized images
+            for (size_t i=0; i<m_options.heights.size(); ++i) {
+                const int h = m_options.heights[i], w = 2 * h;
+                const std::vector<float> pixels = rasterEquirect(f, w, h);
+                const math::RadianceImage image(&pixels[0], w, h);
+                math::SphericalHarmonics sh(bands, math::SphericalHarmonics::TEXELS_ONLY);
+                sh.SetNumThreads(m_options.numThreads);
+                const double seconds = timeOp([&sh, &image]() { sh.ProjectEquirect(image); }, m_options.minTime);
+                add(f, "equirect", sh, w * h, seconds);
+            }
+            for (size_t i=0; i<m_options.faces.size(); ++i) {
+                const int size = m_options.faces[i];
+                const std::vector<float> pixels = rasterCube(f, size);
+                const math::RadianceImage strip(&pixels[0], size, 6 * size);
+                math::RadianceImage faces[6];
+                for (int k=0; k<6; ++k) {
+                    faces[k] = strip.GetRegion(0, k * size, size, size);
+                }
+                math::SphericalHarmonics sh(bands, math::SphericalHarmonics::TEXELS_ONLY);
+                sh.SetNumThreads(m_options.numThreads);
+                const double seconds = timeOp([&sh, &faces]() { sh.ProjectCubeMap(faces); }, m_options.minTime);
+                add(f, "cube", sh, 6 * size * size, seconds);
+            }
+        }
+
+        /// Marks the results of every function that are on its error/time Pareto frontier
+        void FindParetoFrontiers()
+        {
+            for (size_t i=0; i<m_results.size(); ++i) {
+                Result& r = m_results[i];
+                r.pareto = true;
+                for (size_t j=0; j<m_results.size() && r.pareto; ++j) {
+                    const Result& o = m_results[j];
+                    if (j == i || o.function != r.function) continue;
+                    const bool notWorse = o.seconds <= r.seconds && o.functionError <= r.functionError;
+                    const bool better = o.seconds < r.seconds || o.functionError < r.functionError;
+                    r.pareto = !(notWorse && better);
+                }
+            }
+        }
+
+    private:
+        void add(const TestFunction& f, const std::string& mode, const math::SphericalHarmonics& sh, int samples, double seconds)
+        {
+            Result r;
+            r.function = f.name;
+            r.mode = mode;
+            r.bands = sh.GetNumBands();
+            r.samples = samples;
+            r.seconds = seconds;
+            r.pareto = false;
+            measureError(f, sh, &r.coeffError, &r.functionError);
+            m_results.push_back(r);
+            if (m_options.format == FORMAT_TEXT) {
+                fprintf(stderr, "\r%-14s %-24s %2d bands %9d samples", r.function.c_str(), r.mode.c_str(), r.bands, r.samples);
+            }
+        }
+
+    private:
+        const Options&      m_options;
+        std::vector<Result> m_results;
+    };
+
+    bool byTime(const Result* a, const Result* b)
+    {
+        return a->seconds < b->seconds;
+    }
+
+    void printText(const std::vector<Result>& results, const std::vector<TestFunction>& functions, double errorBar)
+    {
+        fprintf(stderr, "\r%70s\r", "");
+        for (size_t f=0; f<functions.size(); ++f) {
+            std::vector<const Result*> rows;
+            for (size_t i=0; i<results.size(); ++i) {
+                if (results[i].function == functions[f].name) rows.push_back(&results[i]);
+            }
+            if (rows.empty()) continue;
+            std::sort(rows.begin(), rows.end(), byTime);
+            printf("\n%s: Pareto frontier of function error against time (* = on the frontier)\n", functions[f].name.c_str());
+            printf("  %-20s %5s %9s %12s %12s %12s\n", "mode", "bands", "samples", "time (us)", "coeff error", "func error");
+            const Result* cheapest = NULL;
+            for (size_t i=0; i<rows.size(); ++i) {
+                const Result& r = *rows[i];
+                if (!r.pareto) continue;
+                printf("* %-20s %5d %9d %12.1f %12.3e %12.3e\n", r.mode.c_str(), r.bands, r.samples,
+                       r.seconds * 1e6, r.coeffError, r.functionError);
+                if (errorBar > 0.0 && cheapest == NULL && r.functionError <= errorBar) {
+                    cheapest = &r;
+                }
+            }
+            if (errorBar > 0.0) {
+                if (cheapest != NULL) {
+                    printf("  cheapest with function error <= %g: %s, %d bands, %d samples, %.1f us\n",
+                           errorBar, cheapest->mode.c_str(), cheapest->bands, cheapest->samples, cheapest->seconds * 1e6);
+                } else {
+                    printf("  no configuration reaches a function error of %g\n", errorBar);
+                }
+            }
+        }
+        printf("\nAll configurations, by time\n");
+        printf("  %-14s %-20s %5s %9s %12s %12s %12s\n", "function", "mode", "bands", "samples", "time (us)", "coeff error", "func error");
+        std::vector<const Result*> rows;
+        for (size_t i=0; i<results.size(); ++i) {
+            rows.push_back(&results[i]);
+        }
+        std::stable_sort(rows.begin(), rows.end(), byTime);
+        for (size_t i=0; i<rows.size(); ++i) {
+            const Result& r = *rows[i];
+            printf("%s %-14s %-20s %5d %9d %12.1f %12.3e %12.3e\n", r.pareto ? "*" : " ", r.function.c_str(),
+                   r.mode.c_str(), r.bands, r.samples, r.seconds * 1e6, r.coeffError, r.functionError);
+        }
+    }
+
+    void printCSV(const std::vector<Result>& results)
+    {
+        printf("function,mode,bands,samples,seconds,coeff_error,function_error,pareto\n");
+        for (size_t i=0; i<results.size(); ++i) {
+            const Result& r = results[i];
+            printf("\"%s\",%s,%d,%d,%.9g,%.6g,%.6g,%d\n", r.function.c_str(), r.mode.c_str(), r.bands, r.samples,
+                   r.seconds, r.coeffError, r.functionError, r.pareto ? 1 : 0);
+        }
+    }
+
+    bool parseList(const char* list, std::vector<double>* values)
+    {
+        values->clear();
+        for (const char* p = list; *p; ) {
+            char* end;
+            const double v = strtod(p, &end);
+            if (end == p || v <= 0.0) return false;
+            values->push_back(v);
+            if (*end != ',' && *end != '\0') return false;
+            p = *end == ',' ? end + 1 : end;
+        }
+        return !values->empty();
+    }
+
+    bool parseInts(const char* list, std::vector<int>* values)
+    {
+        std::vector<double> v;
+        if (!parseList(list, &v)) return false;
+        values->assign(v.begin(), v.end());
+        return true;
+    }
+
+    void printUsage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [options]\n"
+                "Options:\n"
+                "  -b <list>       band counts (default 2,3,4,6)\n"
+                "  -s <list>       sample counts of the point sampling (default 1024,4096,16384,65536,262144)\n"
+                "  -r <list>       equirect heights; maps are twice as wide (default 16,32,64,128,256)\n"
+                "  -c <list>       cube face sizes (default 8,16,32,64,128)\n"
+                "  -p <list>       relative error targets of the progressive projection (default 1e-2,1e-3,1e-4)\n"
+                "  -e <error>      report the cheapest configuration with a function error below it\n"
+                "  -k <substring>  only the test functions whose name contains it\n"
+                "  -f text|csv     output format (default text)\n"
+                "  -t <seconds>    minimum time of every measurement (default 0.02)\n"
+                "  -j <threads>    threads of the projections (default 1; 0 = all)\n",
+                program);
+    }
+
+    bool parseOptions(int argc, char** argv, Options* options)
+    {
+        parseInts("2,3,4,6", &options->bands);
+        parseInts("1024,4096,16384,65536,262144", &options->samples);
+        parseInts("16,32,64,128,256", &options->heights);
+        parseInts("8,16,32,64,128", &options->faces);
+        parseList("1e-2,1e-3,1e-4", &options->targets);
+        for (int i=1; i<argc; ++i) {
+            const std::string arg(argv[i]);
+            if (i + 1 >= argc) return false;
+            const char* value = argv[++i];
+            bool ok = true;
+            if (arg == "-b") ok = parseInts(value, &options->bands);
+            else if (arg == "-s") ok = parseInts(value, &options->samples);
+            else if (arg == "-r") ok = parseInts(value, &options->heights);
+            else if (arg == "-c") ok = parseInts(value, &options->faces);
+            else if (arg == "-p") ok = parseList(value, &options->targets);
+            else if (arg == "-e") options->errorBar = atof(value);
+            else if (arg == "-k") options->filter = value;
+            else if (arg == "-t") options->minTime = atof(value);
+            else if (arg == "-j") options->numThreads = atoi(value);
+            else if (arg == "-f") {
+                const std::string f(value);
+                if (f == "text") options->format = FORMAT_TEXT;
+                else if (f == "csv") options->format = FORMAT_CSV;
+                else ok = false;
+            } else {
+                ok = false;
+            }
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    const std::vector<TestFunction> functions = makeFunctions();
+    Harness harness(options);
+    for (size_t f=0; f<functions.size(); ++f) {
+        if (!options.filter.empty() && functions[f].name.find(options.filter) == std::string::npos) continue;
+        for (size_t b=0; b<options.bands.size(); ++b) {
+            harness.Run(functions[f], options.bands[b]);
+        }
+    }
+    harness.FindParetoFrontiers();
+    if (options.format == FORMAT_CSV) {
+        printCSV(harness.GetResults());
+    } else {
+        printText(harness.GetResults(), functions, options.errorBar);
+    }
+    return 0;
+}
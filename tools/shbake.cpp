@@ -0,0 +1,394 @@
+//
+//  shbake.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Headless batch baker: projects a directory or a manifest of light probes
+//  to Spherical Harmonics, several probes at once, and writes all the
+//  coefficients to a single JSON or binary file.
+//
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+#include "math/SHJobQueue.h"
+#include "math/SphericalHarmonics.h"
+#include "gfx/HdrImage.h"
+#include "gfx/MappedProbe.h"
+
+using namespace vd;
+
+namespace {
+
+    enum OutputFormat {
+        FORMAT_BINARY = 0,
+        FORMAT_JSON
+    };
+
+    /// Layout of the decoded images; raw probes carry their own
+    enum ImageLayout {
+        IMAGE_EQUIRECT = 0,     ///< latitude-longitude map, width = 2 * height
+        IMAGE_CUBE              ///< 6 square faces stacked vertically: +X, -X, +Y, -Y, +Z, -Z
+    };
+
+    /// Header of the binary output, followed by numProbes records of a uint32_t
+    /// status (0 = baked) and numBands² RGB float coefficients, in input order.
+    /// Everything is little-endian.
+    struct BakeHeader {
+        char        magic[4];   ///< "VDSH"
+        uint32_t    version;    ///< BAKE_FILE_VERSION
+        uint32_t    numBands;   ///< bands of every probe
+        uint32_t    numProbes;  ///< records that follow
+    };
+    const uint32_t BAKE_FILE_VERSION = 1;
+
+    const char* const PROBE_EXTENSIONS[] = { ".hdr", ".pic", ".pfm", ".vdrp" };
+
+    struct Options {
+        std::string     input;
+        std::string     output;
+        OutputFormat    format;
+        ImageLayout     layout;
+        int             numBands;
+        int             numThreads;
+        bool            verbose;
+
+        Options()
+        : format(FORMAT_BINARY), layout(IMAGE_EQUIRECT), numBands(3), numThreads(0), verbose(false)
+        {}
+    };
+
+    void printUsage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [options] <probe directory | manifest> -o <output>\n"
+                "  Projects light probes (.hdr, .pic, .pfm or raw .vdrp files) to Spherical Harmonics.\n"
+                "  A manifest is a text file with a probe path per line, relative to the manifest;\n"
+                "  empty lines and lines starting with # are skipped.\n"
+                "Options:\n"
+                "  -o <file>       output file; .json writes JSON, anything else binary\n"
+                "  -f json|binary  output format, overriding the extension\n"
+                "  -b <bands>      number of bands (default 3)\n"
+                "  -j <threads>    probes baked at once (default: all hardware threads)\n"
+                "  -l equirect|cube  layout of .hdr/.pic/.pfm images (default equirect)\n"
+                "  -v              print every probe as it is baked\n",
+                program);
+    }
+
+    bool endsWith(const std::string& s, const char* suffix)
+    {
+        const size_t n = strlen(suffix);
+        if (s.size() < n) return false;
+        for (size_t i=0; i<n; ++i) {
+            const char c = s[s.size() - n + i];
+            if ((c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) != suffix[i]) return false;
+        }
+        return true;
+    }
+
+    bool isProbeFile(const std::string& name)
+    {
+        for (size_t i=0; i<sizeof(PROBE_EXTENSIONS)/sizeof(PROBE_EXTENSIONS[0]); ++i) {
+            if (endsWith(name, PROBE_EXTENSIONS[i])) return true;
+        }
+        return false;
+    }
+
+    bool isDirectory(const std::string& path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    /// Probe files of a directory, sorted by name so the output order is stable
+    bool listDirectory(const std::string& dir, std::vector<std::string>* paths)
+    {
+        DIR* d = opendir(dir.c_str());
+        if (d == NULL) return false;
+        std::vector<std::string> names;
+        for (struct dirent* entry = readdir(d); entry != NULL; entry = readdir(d)) {
+            if (entry->d_name[0] != '.' && isProbeFile(entry->d_name)) {
+                names.push_back(entry->d_name);
+            }
+        }
+        closedir(d);
+        std::sort(names.begin(), names.end());
+        for (size_t i=0; i<names.size(); ++i) {
+            paths->push_back(dir + "/" + names[i]);
+        }
+        return true;
+    }
+
+    bool readManifest(const std::string& manifest, std::vector<std::string>* paths)
+    {
+        FILE* file = fopen(manifest.c_str(), "r");
+        if (file == NULL) return false;
+        const size_t slash = manifest.rfind('/');
+        const std::string base = slash == std::string::npos ? std::string() : manifest.substr(0, slash + 1);
+        char line[4096];
+        while (fgets(line, sizeof(line), file) != NULL) {
+            std::string path(line);
+            while (!path.empty() && (path[path.size()-1] == '\n' || path[path.size()-1] == '\r'
+                                     || path[path.size()-1] == ' ' || path[path.size()-1] == '\t')) {
+                path.erase(path.size()-1);
+            }
+            const size_t start = path.find_first_not_of(" \t");
+            if (start == std::string::npos || path[start] == '#') continue;
+            path = path.substr(start);
+            paths->push_back(path[0] == '/' ? path : base + path);
+        }
+        fclose(file);
+        return true;
+    }
+
+    bool isRawProbe(const std::string& path)
+    {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == NULL) return false;
+        char magic[4] = { 0, 0, 0, 0 };
+        const bool ok = fread(magic, 1, 4, file) == 4;
+        fclose(file);
+        return ok && memcmp(magic, "VDRP", 4) == 0;
+    }
+
+    /**
+     * Projects a probe file into sh with a single thread; the probes are
+     * the unit of parallelism. On failure, error gets the reason.
+     */
+    bool bakeProbe(const std::string& path, ImageLayout layout, math::SphericalHarmonics* sh, std::string* error)
+    {
+        gfx::MappedProbe mapped;
+        gfx::HdrImage decoded;
+        math::RadianceImage image;
+        if (isRawProbe(path)) {
+            if (!mapped.Open(path.c_str())) {
+                *error = mapped.GetError();
+                return false;
+            }
+            image = mapped.GetView();
+            layout = mapped.GetLayout() == gfx::MappedProbe::LAYOUT_CUBE ? IMAGE_CUBE : IMAGE_EQUIRECT;
+        } else {
+            if (!decoded.Load(path.c_str(), 1)) {
+                *error = decoded.GetError();
+                return false;
+            }
+            image = decoded.GetView();
+        }
+        if (layout == IMAGE_CUBE) {
+            if (image.height != 6 * image.width) {
+                *error = "A cube map must be 6 square faces stacked vertically";
+                return false;
+            }
+            math::RadianceImage faces[6];
+            for (int i=0; i<6; ++i) {
+                faces[i] = image.GetRegion(0, i * image.width, image.width, image.width);
+            }
+            sh->ProjectCubeMap(faces);
+        } else {
+            if (image.width % 2 != 0) {
+                *error = "An equirectangular map must have an even width";
+                return false;
+            }
+            sh->ProjectEquirect(image);
+        }
+        return true;
+    }
+
+    /// Escapes a string for a JSON string literal
+    std::string jsonEscape(const std::string& s)
+    {
+        std::string escaped;
+        for (size_t c=0; c<s.size(); ++c) {
+            const unsigned char ch = (unsigned char)s[c];
+            if (ch == '"' || ch == '\\') {
+                escaped += '\\';
+                escaped += (char)ch;
+            } else if (ch < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", ch);
+                escaped += code;
+            } else {
+                escaped += (char)ch;
+            }
+        }
+        return escaped;
+    }
+
+    bool writeJSON(const char* path, int numBands, const std::vector<std::string>& paths,
+                   const std::vector<std::shared_ptr<math::SHJob> >& jobs, const std::vector<std::string>& errors)
+    {
+        FILE* file = fopen(path, "w");
+        if (file == NULL) return false;
+        const int numCoeffs = numBands * numBands;
+        fprintf(file, "{\n  \"bands\": %d,\n  \"probes\": [", numBands);
+        for (size_t i=0; i<jobs.size(); ++i) {
+            fprintf(file, "%s\n    {\"path\": \"%s\", ", i > 0 ? "," : "", jsonEscape(paths[i]).c_str());
+            std::shared_ptr<math::SphericalHarmonics> sh = jobs[i]->GetResult();
+            if (!sh) {
+                fprintf(file, "\"error\": \"%s\"}", jsonEscape(errors[i]).c_str());
+                continue;
+            }
+            fprintf(file, "\"coeffs\": [");
+            const math::Vector3* coeffs = sh->GetCoeffs();
+            for (int n=0; n<numCoeffs; ++n) {
+                fprintf(file, "%s[%.9g, %.9g, %.9g]", n > 0 ? ", " : "",
+                        coeffs[n].GetX(), coeffs[n].GetY(), coeffs[n].GetZ());
+            }
+            fprintf(file, "]}");
+        }
+        fprintf(file, "\n  ]\n}\n");
+        return fclose(file) == 0;
+    }
+
+    bool writeBinary(const char* path, int numBands, const std::vector<std::shared_ptr<math::SHJob> >& jobs)
+    {
+        const uint16_t one = 1;
+        if (*(const unsigned char*)&one != 1) {
+            fprintf(stderr, "The binary format can only be written on little-endian hosts\n");
+            return false;
+        }
+        FILE* file = fopen(path, "wb");
+        if (file == NULL) return false;
+        const int numCoeffs = numBands * numBands;
+        BakeHeader header;
+        memcpy(header.magic, "VDSH", 4);
+        header.version = BAKE_FILE_VERSION;
+        header.numBands = (uint32_t)numBands;
+        header.numProbes = (uint32_t)jobs.size();
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        std::vector<float> record(numCoeffs * 3);
+        for (size_t i=0; i<jobs.size() && ok; ++i) {
+            std::shared_ptr<math::SphericalHarmonics> sh = jobs[i]->GetResult();
+            const uint32_t status = sh ? 0 : 1;
+            std::fill(record.begin(), record.end(), 0.f);
+            for (int n=0; n<numCoeffs && sh; ++n) {
+                record[n*3] = sh->GetCoeffs()[n].GetX();
+                record[n*3+1] = sh->GetCoeffs()[n].GetY();
+                record[n*3+2] = sh->GetCoeffs()[n].GetZ();
+            }
+            ok = fwrite(&status, sizeof(status), 1, file) == 1
+              && fwrite(&record[0], sizeof(float), record.size(), file) == record.size();
+        }
+        return fclose(file) == 0 && ok;
+    }
+
+    bool parseOptions(int argc, char** argv, Options* options)
+    {
+        bool formatGiven = false;
+        for (int i=1; i<argc; ++i) {
+            const std::string arg(argv[i]);
+            const bool hasValue = i + 1 < argc;
+            if (arg == "-o" && hasValue) {
+                options->output = argv[++i];
+            } else if (arg == "-f" && hasValue) {
+                const std::string value(argv[++i]);
+                if (value != "json" && value != "binary") return false;
+                options->format = value == "json" ? FORMAT_JSON : FORMAT_BINARY;
+                formatGiven = true;
+            } else if (arg == "-b" && hasValue) {
+                options->numBands = atoi(argv[++i]);
+                if (options->numBands < 1) return false;
+            } else if (arg == "-j" && hasValue) {
+                options->numThreads = atoi(argv[++i]);
+            } else if (arg == "-l" && hasValue) {
+                const std::string value(argv[++i]);
+                if (value != "equirect" && value != "cube") return false;
+                options->layout = value == "cube" ? IMAGE_CUBE : IMAGE_EQUIRECT;
+            } else if (arg == "-v") {
+                options->verbose = true;
+            } else if (arg[0] != '-' && options->input.empty()) {
+                options->input = arg;
+            } else {
+                return false;
+            }
+        }
+        if (!formatGiven) {
+            options->format = endsWith(options->output, ".json") ? FORMAT_JSON : FORMAT_BINARY;
+        }
+        return !options->input.empty() && !options->output.empty();
+    }
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    std::vector<std::string> paths;
+    const bool listed = isDirectory(options.input) ? listDirectory(options.input, &paths)
+                                                   : readManifest(options.input, &paths);
+    if (!listed) {
+        fprintf(stderr, "Can't read %s\n", options.input.c_str());
+        return 1;
+    }
+    if (paths.empty()) {
+        fprintf(stderr, "No probes in %s\n", options.input.c_str());
+        return 1;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+
+    // every probe is a single-threaded job; the texel tables are shared by all of them
+    math::SHJobQueue queue(options.numThreads);
+    math::SHJobDesc desc(options.numBands);
+    std::vector<std::shared_ptr<math::SHJob> > jobs(paths.size());
+    std::vector<std::string> errors(paths.size());
+    for (size_t i=0; i<paths.size(); ++i) {
+        const std::string& path = paths[i];
+        std::string* error = &errors[i];
+        const ImageLayout layout = options.layout;
+        jobs[i] = queue.Submit([desc, path, layout, error](math::SHJob&) {
+            try {
+                std::shared_ptr<math::SphericalHarmonics> sh =
+                    std::make_shared<math::SphericalHarmonics>(desc.numBands, math::SphericalHarmonics::TEXELS_ONLY);
+                sh->SetNumThreads(desc.numThreads);
+                if (bakeProbe(path, layout, sh.get(), error)) {
+                    return sh;
+                }
+            } catch (const std::exception& e) {
+                // e.g. std::bad_alloc for an image that is too large for this machine
+                *error = e.what();
+            }
+            return std::shared_ptr<math::SphericalHarmonics>();
+        });
+    }
+
+    int numFailed = 0;
+    for (size_t i=0; i<jobs.size(); ++i) {
+        if (!jobs[i]->Wait()) {
+            ++numFailed;
+            fprintf(stderr, "%s: %s\n", paths[i].c_str(), errors[i].c_str());
+        } else if (options.verbose) {
+            fprintf(stderr, "%s\n", paths[i].c_str());
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const bool written = options.format == FORMAT_JSON
+        ? writeJSON(options.output.c_str(), options.numBands, paths, jobs, errors)
+        : writeBinary(options.output.c_str(), options.numBands, jobs);
+    if (!written) {
+        fprintf(stderr, "Can't write %s\n", options.output.c_str());
+        return 1;
+    }
+
+    const int numBaked = (int)jobs.size() - numFailed;
+    fprintf(stderr, "Baked %d probes (%d failed) with %d threads in %.3f s: %.1f probes/s\n",
+            numBaked, numFailed, queue.GetNumWorkers(), seconds, seconds > 0.0 ? numBaked / seconds : 0.0);
+    return numFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,521 @@
+//
+//  shbench.cpp
+//  Harmoniker
+//
+//  Copyright (c) 2026 David Gavilan. All rights reserved.
+//
+//  Microbenchmarks of the hot SH, math and color kernels. Every benchmark is
+//  run for at least a minimum time and reports the time per operation, the
+//  items (samples, texels, calls) processed per second and the bytes each
+//  operation touches, as a table, CSV or JSON.
+//
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include "math/Matrix.h"
+#include "math/Parallel.h"
+#include "math/Quaternion.h"
+#include "math/SHSampleSet.h"
+#include "math/SimdFloat.h"
+#include "math/SphericalHarmonics.h"
+#include "gfx/Color.h"
+#include "gfx/ColorConversion.h"
+#include "gfx/IrradianceRenderer.h"
+
+using namespace vd;
+
+namespace {
+
+    enum OutputFormat {
+        FORMAT_TEXT = 0,
+        FORMAT_CSV,
+        FORMAT_JSON
+    };
+
+    struct ImageSize {
+        int width;
+        int height;
+    };
+
+    struct Options {
+        std::vector<int>        bands;
+        std::vector<int>        samples;
+        std::vector<ImageSize>  images;
+        std::string             filter;
+        OutputFormat            format;
+        double                  minTime;
+        int                     numThreads;
+
+        Options()
+        : format(FORMAT_TEXT), minTime(0.2), numThreads(1)
+        {}
+    };
+
+    /// Outcome of a benchmark
+    struct Result {
+        std::string name;
+        int         bands;          ///< 0 if it does not apply
+        int         samples;        ///< 0 if it does not apply
+        int         width;          ///< 0 if it does not apply
+        int         height;         ///< 0 if it does not apply
+        long long   iterations;     ///< operations timed
+        double      nsPerOp;        ///< mean time of an operation
+        double      itemsPerOp;     ///< samples, texels or calls of an operation
+        double      bytesPerOp;     ///< estimated memory read and written by an operation
+    };
+
+    /// Results are added here so the compiler can't discard the benchmarked code
+    volatile float g_sink = 0.f;
+
+    /**
+     * Runs op until minTime has passed, doubling the batch size, after a
+     * warm-up call, and returns the mean time of an operation in ns.
+     */
+    double timeOp(const std::function<void()>& op, double minTime, long long* iterations)
+    {
+        typedef std::chrono::steady_clock Clock;
+        op();
+        long long batch = 1;
+        long long count = 0;
+        double elapsed = 0.0;
+        while (elapsed < minTime) {
+            const Clock::time_point start = Clock::now();
+            for (long long i=0; i<batch; ++i) {
+                op();
+            }
+            elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+            count += batch;
+            if (batch < (1LL << 30)) batch *= 2;
+        }
+        *iterations = count;
+        return elapsed * 1e9 / (double)count;
+    }
+
+    /// Synthetic probe: smooth gradients and a bright spot, so every band has energy
+    std::vector<float> makeProbe(int width, int height)
+    {
+        std::vector<float> pixels((size_t)width * height * 3);
+        for (int y=0; y<height; ++y) {
+            for (int x=0; x<width; ++x) {
+                const float u = (x + 0.5f) / width;
+                const float v = (y + 0.5f) / height;
+                const float spot = expf(-((u - 0.3f) * (u - 0.3f) + (v - 0.4f) * (v - 0.4f)) * 200.f);
+                float* p = &pixels[3 * ((size_t)y * width + x)];
+                p[0] = 0.2f + 0.8f * v + 10.f * spot;
+                p[1] = 0.5f + 0.5f * sinf(6.2831853f * u) + 8.f * spot;
+                p[2] = 1.f - v + 6.f * spot;
+            }
+        }
+        return pixels;
+    }
+
+    /// The probe looked up by probeSampler
+    math::RadianceImage g_probe;
+
+    /// Nearest texel of g_probe, as the sampler of the application does
+    math::Vector3 probeSampler(double theta, double phi)
+    {
+        const int x = std::min(g_probe.width - 1, (int)(phi * math::PI_INV * 0.5 * g_probe.width));
+        const int y = std::min(g_probe.height - 1, (int)(theta * math::PI_INV * g_probe.height));
+        const float* p = g_probe.GetPixel(x, y);
+        return math::Vector3(p[0], p[1], p[2]);
+    }
+
+    class Bench {
+    public:
+        explicit Bench(const Options& options) : m_options(options) {}
+
+        const std::vector<Result>& GetResults() const { return m_results; }
+
+        /**
+         * Times op, unless the filter excludes it
+         * @param items processed by every call of op
+         * @param bytes touched by every call of op
+         */
+        void Run(const std::string& name, int bands, int samples, int width, int height,
+                 double items, double bytes, const std::function<void()>& op)
+        {
+            if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos) return;
+            Result r;
+            r.name = name;
+            r.bands = bands;
+            r.samples = samples;
+            r.width = width;
+            r.height = height;
+            r.nsPerOp = timeOp(op, m_options.minTime, &r.iterations);
+            r.itemsPerOp = items;
+            r.bytesPerOp = bytes;
+            m_results.push_back(r);
+            if (m_options.format == FORMAT_TEXT) {
+                printText(r);
+            }
+        }
+
+        static void PrintTextHeader() {
+            printf("%-36s %5s %8s %11s %14s %14s %12s %9s\n",
+                   "benchmark", "bands", "samples", "image", "ns/op", "items/s", "bytes/op", "GB/s");
+        }
+
+    private:
+        static void printText(const Result& r) {
+            char image[32] = "-";
+            if (r.width > 0) snprintf(image, sizeof(image), "%dx%d", r.width, r.height);
+            const double seconds = r.nsPerOp * 1e-9;
+            printf("%-36s %5d %8d %11s %14.1f %14.4g %12.4g %9.3f\n",
+                   r.name.c_str(), r.bands, r.samples, image, r.nsPerOp,
+                   r.itemsPerOp / seconds, r.bytesPerOp, r.bytesPerOp / seconds * 1e-9);
+            fflush(stdout);
+        }
+
+    private:
+        const Options&      m_options;
+        std::vector<Result> m_results;
+    };
+
+    // -----------------------------------------------------------
+    // benchmarks
+    // -----------------------------------------------------------
+
+    /// Scalar Legendre, normalization and basis functions: an op evaluates every (l, m) of the bands
+    void benchScalarBasis(Bench& bench, int bands)
+    {
+        const int numCalls = bands * (bands + 1) / 2;
+        bench.Run("SphericalHarmonics::P", bands, 0, 0, 0, numCalls, 0, [bands]() {
+            float sum = 0.f;
+            for (int l=0; l<bands; ++l) {
+                for (int m=0; m<=l; ++m) {
+                    sum += (float)math::SphericalHarmonics::P(l, m, 0.3 + 0.01 * m);
+                }
+            }
+            g_sink = g_sink + sum;
+        });
+        bench.Run("SphericalHarmonics::K", bands, 0, 0, 0, numCalls, 0, [bands]() {
+            float sum = 0.f;
+            for (int l=0; l<bands; ++l) {
+                for (int m=0; m<=l; ++m) {
+                    sum += (float)math::SphericalHarmonics::K(l, m);
+                }
+            }
+            g_sink = g_sink + sum;
+        });
+        bench.Run("SphericalHarmonics::SH", bands, 0, 0, 0, bands * bands, 0, [bands]() {
+            float sum = 0.f;
+            for (int l=0; l<bands; ++l) {
+                for (int m=-l; m<=l; ++m) {
+                    sum += (float)math::SphericalHarmonics::SH(l, m, 1.1, 2.3);
+                }
+            }
+            g_sink = g_sink + sum;
+        });
+        std::vector<double> basis(bands * bands);
+        bench.Run("SphericalHarmonics::SHAll", bands, 0, 0, 0, bands * bands, basis.size() * sizeof(double), [bands, &basis]() {
+            math::SphericalHarmonics::SHAll(bands, 1.1, 2.3, &basis[0]);
+            g_sink = g_sink + (float)basis[bands * bands - 1];
+        });
+    }
+
+    /// Sample set generation, which replaced setupSphericalSamples, and projections of samples
+    void benchSamples(Bench& bench, int bands, int samples, int numThreads)
+    {
+        const double setBytes = (double)math::SHSampleSet(bands, samples).GetSizeInBytes();
+        bench.Run("SHSampleSet::Generate", bands, samples, 0, 0, samples, setBytes, [bands, samples, numThreads]() {
+            math::SHSampleSet set(bands, samples, math::SAMPLE_GENERATOR_FIBONACCI);
+            set.Generate(numThreads);
+            g_sink = g_sink + set.GetBasis(0)[0];
+        });
+
+        math::SphericalHarmonics sh(bands, math::SAMPLE_GENERATOR_FIBONACCI, samples);
+        sh.SetNumThreads(numThreads);
+        // basis, theta & phi and radiance are read; radiance is also written by ProjectPolarFn
+        const double basisBytes = (double)samples * bands * bands * sizeof(float);
+        const double radianceBytes = (double)samples * sizeof(math::Vector3);
+        bench.Run("SphericalHarmonics::ProjectPolarFn", bands, samples, g_probe.width, g_probe.height, samples,
+                  basisBytes + samples * 2 * sizeof(float) + 2 * radianceBytes, [&sh]() {
+            g_sink = g_sink + sh.ProjectPolarFn(&probeSampler)[0].GetX();
+        });
+        std::vector<math::Vector3> radiance(samples);
+        for (int i=0; i<samples; ++i) {
+            radiance[i] = probeSampler(sh.GetSamples().GetTheta()[i], sh.GetSamples().GetPhi()[i]);
+        }
+        bench.Run("SphericalHarmonics::ProjectRadiance", bands, samples, 0, 0, samples, basisBytes + radianceBytes, [&sh, &radiance]() {
+            g_sink = g_sink + sh.ProjectRadiance(&radiance[0])[0].GetX();
+        });
+    }
+
+    /// Exact texel projections and irradiance rendering of an image size
+    void benchImages(Bench& bench, int bands, const ImageSize& size, int numThreads)
+    {
+        const int w = size.width, h = size.height;
+        const double texels = (double)w * h;
+        math::SphericalHarmonics sh(bands, math::SphericalHarmonics::TEXELS_ONLY);
+        sh.SetNumThreads(numThreads);
+        bench.Run("SphericalHarmonics::ProjectEquirect", bands, 0, w, h, texels, texels * 3 * sizeof(float), [&sh]() {
+            g_sink = g_sink + sh.ProjectEquirect(g_probe)[0].GetX();
+        });
+        const int face = w / 4;
+        math::RadianceImage faces[6];
+        for (int i=0; i<6; ++i) {
+            faces[i] = g_probe.GetRegion(0, 0, face, face);
+        }
+        bench.Run("SphericalHarmonics::ProjectCubeMap", bands, 0, face, 6 * face, 6.0 * face * face,
+                  6.0 * face * face * 3 * sizeof(float), [&sh, &faces]() {
+            g_sink = g_sink + sh.ProjectCubeMap(faces)[0].GetX();
+        });
+
+        gfx::IrradianceRenderer renderer(sh);
+        renderer.SetNumThreads(numThreads);
+        std::vector<float> rgb((size_t)w * h * 3);
+        bench.Run("IrradianceRenderer::Render", bands, 0, w, h, texels, texels * 3 * sizeof(float), [&renderer, &rgb, w, h]() {
+            renderer.Render(gfx::IrradianceRenderer::LAYOUT_EQUIRECT, w, h, &rgb[0]);
+            g_sink = g_sink + rgb[0];
+        });
+    }
+
+    /// Irradiance of single normals and of arrays of normals
+    void benchIrradiance(Bench& bench, int bands)
+    {
+        math::SphericalHarmonics sh(bands, math::SAMPLE_GENERATOR_FIBONACCI, 4096);
+        sh.ProjectPolarFn(&probeSampler);
+        const int count = 1024;
+        std::vector<float> x(count), y(count), z(count), r(count), g(count), b(count);
+        for (int i=0; i<count; ++i) {
+            const float theta = math::PI * (i + 0.5f) / count;
+            const float phi = 2.399963f * i;
+            x[i] = sinf(theta) * sinf(phi);
+            y[i] = cosf(theta);
+            z[i] = sinf(theta) * cosf(phi);
+        }
+        bench.Run("GetIrradianceApproximation", bands, 0, 0, 0, count, count * 6 * sizeof(float), [&]() {
+            float sum = 0.f;
+            for (int i=0; i<count; ++i) {
+                sum += sh.GetIrradianceApproximation(math::Vector3(x[i], y[i], z[i])).GetX();
+            }
+            g_sink = g_sink + sum;
+        });
+        bench.Run("GetIrradianceApproximation/batch", bands, 0, 0, 0, count, count * 6 * sizeof(float), [&]() {
+            sh.GetIrradianceApproximation(count, &x[0], &y[0], &z[0], &r[0], &g[0], &b[0]);
+            g_sink = g_sink + r[0];
+        });
+    }
+
+    /// Color conversions, matrices and quaternions: 1024 calls per op
+    void benchMisc(Bench& bench, const ImageSize& size)
+    {
+        const int count = 1024;
+        std::vector<gfx::Color> colors;
+        for (int i=0; i<count; ++i) {
+            const float t = (i + 0.5f) / count;
+            colors.push_back(gfx::Color(t, 1.f - t, 0.5f * t, 1.f));
+        }
+        bench.Run("Color::ChangeColorSpace", 0, 0, 0, 0, count, count * 2 * sizeof(float) * 4, [&colors]() {
+            float sum = 0.f;
+            for (int i=0; i<count; ++i) {
+                sum += colors[i].ChangeColorSpace(gfx::Color::COLORSPACE_RGB).GetR();
+            }
+            g_sink = g_sink + sum;
+        });
+        const size_t pixels = (size_t)size.width * size.height;
+        std::vector<unsigned char> srgb(pixels * 4, 128);
+        std::vector<float> linear(pixels * 3);
+        bench.Run("SRGB8ToLinear", 0, 0, size.width, size.height, (double)pixels, pixels * (4 + 3 * sizeof(float)), [&]() {
+            gfx::SRGB8ToLinear(&srgb[0], 4, pixels, &linear[0]);
+            g_sink = g_sink + linear[0];
+        });
+        bench.Run("LinearToSRGB8", 0, 0, size.width, size.height, (double)pixels, pixels * (3 + 3 * sizeof(float)), [&]() {
+            gfx::LinearToSRGB8(&linear[0], &srgb[0], pixels * 3);
+            g_sink = g_sink + srgb[0];
+        });
+
+        std::vector<math::Matrix4> matrices(count);
+        for (int i=0; i<count; ++i) {
+            for (int k=0; k<16; ++k) {
+                matrices[i](k % 4, k / 4) = (float)((i + k) % 7) - 3.f;
+            }
+        }
+        bench.Run("Matrix4::operator*", 0, 0, 0, 0, count, count * 3 * sizeof(math::Matrix4), [&matrices]() {
+            float sum = 0.f;
+            for (int i=0; i<count; ++i) {
+                sum += (matrices[i] * matrices[(i + 1) % count])(0, 0);
+            }
+            g_sink = g_sink + sum;
+        });
+
+        std::vector<math::Quat> quats(count + 1);
+        for (int i=0; i<=count; ++i) {
+            quats[i] = math::Quat::CreateRotationAxis(0.01f * i, math::Vector3(0.f, 1.f, 0.f));
+        }
+        bench.Run("Slerp", 0, 0, 0, 0, count, count * 3 * sizeof(math::Quat), [&quats]() {
+            float sum = 0.f;
+            for (int i=0; i<count; ++i) {
+                sum += math::Slerp(quats[i], quats[i + 1], 0.3f).GetW();
+            }
+            g_sink = g_sink + sum;
+        });
+    }
+
+    // -----------------------------------------------------------
+    // output & options
+    // -----------------------------------------------------------
+
+    void printCSV(const std::vector<Result>& results)
+    {
+        printf("benchmark,bands,samples,width,height,iterations,ns_per_op,items_per_s,bytes_per_op,gb_per_s\n");
+        for (size_t i=0; i<results.size(); ++i) {
+            const Result& r = results[i];
+            const double seconds = r.nsPerOp * 1e-9;
+            printf("%s,%d,%d,%d,%d,%lld,%.3f,%.6g,%.6g,%.6g\n", r.name.c_str(), r.bands, r.samples, r.width, r.height,
+                   r.iterations, r.nsPerOp, r.itemsPerOp / seconds, r.bytesPerOp, r.bytesPerOp / seconds * 1e-9);
+        }
+    }
+
+    void printJSON(const std::vector<Result>& results, int numThreads)
+    {
+        printf("{\n  \"threads\": %d,\n  \"hardware_threads\": %d,\n  \"simd_width\": %d,\n  \"results\": [",
+               math::ResolveNumThreads(numThreads), math::GetHardwareThreads(), math::SimdFloat::WIDTH);
+        for (size_t i=0; i<results.size(); ++i) {
+            const Result& r = results[i];
+            const double seconds = r.nsPerOp * 1e-9;
+            printf("%s\n    {\"benchmark\": \"%s\", \"bands\": %d, \"samples\": %d, \"width\": %d, \"height\": %d, "
+                   "\"iterations\": %lld, \"ns_per_op\": %.3f, \"items_per_s\": %.6g, \"bytes_per_op\": %.6g, \"gb_per_s\": %.6g}",
+                   i > 0 ? "," : "", r.name.c_str(), r.bands, r.samples, r.width, r.height,
+                   r.iterations, r.nsPerOp, r.itemsPerOp / seconds, r.bytesPerOp, r.bytesPerOp / seconds * 1e-9);
+        }
+        printf("\n  ]\n}\n");
+    }
+
+    bool parseInts(const char* list, std::vector<int>* values)
+    {
+        values->clear();
+        for (const char* p = list; *p; ) {
+            char* end;
+            const long v = strtol(p, &end, 10);
+            if (end == p || v <= 0) return false;
+            values->push_back((int)v);
+            p = *end == ',' ? end + 1 : end;
+            if (*end != ',' && *end != '\0') return false;
+        }
+        return !values->empty();
+    }
+
+    bool parseSizes(const char* list, std::vector<ImageSize>* sizes)
+    {
+        sizes->clear();
+        for (const char* p = list; *p; ) {
+            ImageSize size;
+            int consumed = 0;
+            if (sscanf(p, "%dx%d%n", &size.width, &size.height, &consumed) != 2
+                || size.width < 8 || size.height < 4 || size.width % 2 != 0) {
+                return false;
+            }
+            sizes->push_back(size);
+            p += consumed;
+            if (*p == ',') ++p;
+            else if (*p != '\0') return false;
+        }
+        return !sizes->empty();
+    }
+
+    void printUsage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [options]\n"
+                "Options:\n"
+                "  -b <list>       band counts (default 2,3,4,6)\n"
+                "  -s <list>       sample counts (default 4096,65536,262144)\n"
+                "  -i <list>       synthetic probe sizes, WxH (default 256x128,1024x512)\n"
+                "  -f text|csv|json  output format (default text)\n"
+                "  -t <seconds>    minimum time of every measurement (default 0.2)\n"
+                "  -j <threads>    threads of the parallel kernels (default 1; 0 = all)\n"
+                "  -k <substring>  only the benchmarks whose name contains it\n",
+                program);
+    }
+
+    bool parseOptions(int argc, char** argv, Options* options)
+    {
+        parseInts("2,3,4,6", &options->bands);
+        parseInts("4096,65536,262144", &options->samples);
+        parseSizes("256x128,1024x512", &options->images);
+        for (int i=1; i<argc; ++i) {
+            const std::string arg(argv[i]);
+            if (i + 1 >= argc) return false;
+            const char* value = argv[++i];
+            if (arg == "-b") {
+                if (!parseInts(value, &options->bands)) return false;
+            } else if (arg == "-s") {
+                if (!parseInts(value, &options->samples)) return false;
+            } else if (arg == "-i") {
+                if (!parseSizes(value, &options->images)) return false;
+            } else if (arg == "-f") {
+                const std::string f(value);
+                if (f == "text") options->format = FORMAT_TEXT;
+                else if (f == "csv") options->format = FORMAT_CSV;
+                else if (f == "json") options->format = FORMAT_JSON;
+                else return false;
+            } else if (arg == "-t") {
+                options->minTime = atof(value);
+            } else if (arg == "-j") {
+                options->numThreads = atoi(value);
+            } else if (arg == "-k") {
+                options->filter = value;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (options.format == FORMAT_TEXT) {
+        printf("threads: %d (hardware: %d), SIMD width: %d\n",
+               math::ResolveNumThreads(options.numThreads), math::GetHardwareThreads(), math::SimdFloat::WIDTH);
+        Bench::PrintTextHeader();
+    }
+    Bench bench(options);
+
+    // the first probe size feeds the polar function
+    std::vector<float> probe = makeProbe(options.images[0].width, options.images[0].height);
+    g_probe = math::RadianceImage(&probe[0], options.images[0].width, options.images[0].height);
+
+    for (size_t b=0; b<options.bands.size(); ++b) {
+        benchScalarBasis(bench, options.bands[b]);
+    }
+    for (size_t b=0; b<options.bands.size(); ++b) {
+        for (size_t s=0; s<options.samples.size(); ++s) {
+            benchSamples(bench, options.bands[b], options.samples[s], options.numThreads);
+        }
+    }
+    for (size_t b=0; b<options.bands.size(); ++b) {
+        benchIrradiance(bench, options.bands[b]);
+    }
+    for (size_t i=0; i<options.images.size(); ++i) {
+        probe = makeProbe(options.images[i].width, options.images[i].height);
+        g_probe = math::RadianceImage(&probe[0], options.images[i].width, options.images[i].height);
+        for (size_t b=0; b<options.bands.size(); ++b) {
+            benchImages(bench, options.bands[b], options.images[i], options.numThreads);
+        }
+        benchMisc(bench, options.images[i]);
+    }
+
+    if (options.format == FORMAT_CSV) {
+        printCSV(bench.GetResults());
+    } else if (options.format == FORMAT_JSON) {
+        printJSON(bench.GetResults(), options.numThreads);
+    }
+    return 0;
+}